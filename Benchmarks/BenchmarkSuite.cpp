@@ -0,0 +1,227 @@
+#include "BenchmarkSuite.h"
+
+#include <cctype>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <utility>
+
+BenchmarkSuite::BenchmarkSuite(std::string filter, const size_t repetitions)
+    : filter_(std::move(filter)), repetitions_(std::max<size_t>(repetitions, 1))
+{
+}
+
+void BenchmarkSuite::record(const BenchmarkResult &result)
+{
+    std::cout << std::left << std::setw(44) << result.name << std::right << std::setw(16) << std::fixed << std::setprecision(2)
+        << result.ns_per_op << " ns/op" << std::endl;
+
+    results_.push_back(result);
+}
+
+void BenchmarkSuite::report_speedup(const std::string &label, const double baseline_ns, const double improved_ns) const
+{
+    if (baseline_ns > 0 && improved_ns > 0)
+    {
+        std::cout << label << ": " << std::setprecision(2) << baseline_ns / improved_ns << "x" << std::endl;
+    }
+}
+
+namespace
+{
+// names are plain text, only quotes and backslashes need escaping
+std::string escape(const std::string &text)
+{
+    std::string escaped;
+    for (const char c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+}
+
+void BenchmarkSuite::write_json(std::ostream &output) const
+{
+    output << "{\n  \"benchmarks\": [";
+    for (size_t i = 0; i < results_.size(); ++i)
+    {
+        output << (i == 0 ? "\n" : ",\n")
+            << "    { \"name\": \"" << escape(results_[i].name) << "\", "
+            << "\"ns_per_op\": " << std::setprecision(17) << results_[i].ns_per_op << ", "
+            << "\"iterations\": " << results_[i].iterations << " }";
+    }
+    output << "\n  ]\n}\n";
+}
+
+namespace
+{
+class JsonReader
+{
+public:
+    explicit JsonReader(std::istream &input)
+    {
+        std::ostringstream text;
+        text << input.rdbuf();
+        text_ = text.str();
+    }
+
+    bool consume(const char expected)
+    {
+        skip_space();
+        if (position_ < text_.size() && text_[position_] == expected)
+        {
+            ++position_;
+            return true;
+        }
+        return false;
+    }
+
+    bool read_string(std::string &value)
+    {
+        if (!consume('"'))
+        {
+            return false;
+        }
+
+        value.clear();
+        while (position_ < text_.size() && text_[position_] != '"')
+        {
+            if (text_[position_] == '\\' && position_ + 1 < text_.size())
+            {
+                ++position_;
+            }
+            value += text_[position_++];
+        }
+        return consume('"');
+    }
+
+    bool read_number(double &value)
+    {
+        skip_space();
+        size_t length = 0;
+        try
+        {
+            value = std::stod(text_.substr(position_, 32), &length);
+        }
+        catch (const std::exception &)
+        {
+            return false;
+        }
+        position_ += length;
+        return true;
+    }
+
+private:
+    std::string text_;
+    size_t position_ = 0;
+
+    void skip_space()
+    {
+        while (position_ < text_.size() && std::isspace(static_cast<unsigned char>(text_[position_])))
+        {
+            ++position_;
+        }
+    }
+};
+}
+
+std::optional<std::vector<BenchmarkResult>> read_json(std::istream &input)
+{
+    std::vector<BenchmarkResult> results;
+    JsonReader reader(input);
+
+    std::string key;
+    if (!reader.consume('{') || !reader.read_string(key) || key != "benchmarks" || !reader.consume(':') || !reader.consume('['))
+    {
+        return std::nullopt;
+    }
+
+    while (reader.consume('{'))
+    {
+        BenchmarkResult result;
+        do
+        {
+            if (!reader.read_string(key) || !reader.consume(':'))
+            {
+                return std::nullopt;
+            }
+
+            double number = 0;
+            if (key == "name")
+            {
+                if (!reader.read_string(result.name))
+                {
+                    return std::nullopt;
+                }
+            }
+            else if (reader.read_number(number))
+            {
+                if (key == "ns_per_op")
+                {
+                    result.ns_per_op = number;
+                }
+                else if (key == "iterations")
+                {
+                    result.iterations = static_cast<size_t>(number);
+                }
+            }
+            else
+            {
+                return std::nullopt;
+            }
+        } while (reader.consume(','));
+
+        if (!reader.consume('}'))
+        {
+            return std::nullopt;
+        }
+        results.push_back(result);
+        reader.consume(',');
+    }
+
+    if (!reader.consume(']') || !reader.consume('}'))
+    {
+        return std::nullopt;
+    }
+    return results;
+}
+
+Comparison compare(const std::vector<BenchmarkResult> &baseline, const std::vector<BenchmarkResult> &current,
+                   const double threshold_percent, std::ostream &output)
+{
+    Comparison comparison;
+    for (const BenchmarkResult &now : current)
+    {
+        const auto before = std::find_if(baseline.begin(), baseline.end(), [&](const BenchmarkResult &r) { return r.name == now.name; });
+        if (before == baseline.end() || before->ns_per_op <= 0)
+        {
+            output << std::left << std::setw(44) << now.name << "  new" << std::endl;
+            continue;
+        }
+
+        const double change = (now.ns_per_op / before->ns_per_op - 1) * 100;
+        const bool regressed = change > threshold_percent;
+        ++comparison.compared;
+        comparison.regressions += regressed ? 1 : 0;
+
+        output << std::left << std::setw(44) << now.name << std::right << std::setw(16) << std::fixed << std::setprecision(2)
+            << before->ns_per_op << " -> " << std::setw(16) << now.ns_per_op << " ns/op  "
+            << std::showpos << std::setw(8) << change << std::noshowpos << "%"
+            << (regressed ? "  REGRESSION" : "") << std::endl;
+    }
+
+    for (const BenchmarkResult &before : baseline)
+    {
+        if (std::none_of(current.begin(), current.end(), [&](const BenchmarkResult &r) { return r.name == before.name; }))
+        {
+            output << std::left << std::setw(44) << before.name << "  missing" << std::endl;
+        }
+    }
+
+    return comparison;
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <iosfwd>
+#include <optional>
+#include <string>
+#include <vector>
+
+struct BenchmarkResult
+{
+    std::string name;
+    double ns_per_op = 0;
+    size_t iterations = 0;
+};
+
+/*
+ * Times named benchmarks, prints them as they finish and keeps the results for JSON output.
+ *
+ * Every benchmark runs repetitions times and reports the median, which is what
+ * comparisons between runs rely on: one preempted repetition does not move it.
+ */
+class BenchmarkSuite
+{
+public:
+    BenchmarkSuite(std::string filter, size_t repetitions);
+
+    /*
+     * Runs fn(i) iterations times per repetition and returns the median time per call.
+     * fn returns a float that is accumulated into a volatile sink, so the optimizer
+     * cannot throw the work away.
+     * Benchmarks whose name does not contain the filter are skipped and return 0.
+     */
+    template <typename Fn>
+    double measure(const std::string &name, const size_t iterations, Fn fn)
+    {
+        if (name.find(filter_) == std::string::npos)
+        {
+            return 0;
+        }
+
+        volatile float sink = 0;
+        std::vector<double> samples;
+        for (size_t repetition = 0; repetition < repetitions_; ++repetition)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < iterations; ++i)
+            {
+                sink = sink + fn(i);
+            }
+            const auto end = std::chrono::steady_clock::now();
+
+            samples.push_back(std::chrono::duration<double, std::nano>(end - start).count() / static_cast<double>(iterations));
+        }
+
+        std::nth_element(samples.begin(), samples.begin() + samples.size() / 2, samples.end());
+        const double ns_per_op = samples[samples.size() / 2];
+        record(BenchmarkResult{ name, ns_per_op, iterations });
+
+        return ns_per_op;
+    }
+
+    // a speedup line, if neither side was filtered out
+    void report_speedup(const std::string &label, double baseline_ns, double improved_ns) const;
+
+    [[nodiscard]]
+    const std::vector<BenchmarkResult> &results() const
+    {
+        return results_;
+    }
+
+    void write_json(std::ostream &output) const;
+
+private:
+    std::string filter_;
+    size_t repetitions_;
+    std::vector<BenchmarkResult> results_;
+
+    void record(const BenchmarkResult &result);
+};
+
+/*
+ * Reads what write_json wrote. Unknown keys are skipped.
+ * Returns nothing if the input is not this shape of JSON.
+ */
+std::optional<std::vector<BenchmarkResult>> read_json(std::istream &input);
+
+struct Comparison
+{
+    // benchmarks present in both runs
+    size_t compared = 0;
+    // of those, how many got slower than the threshold
+    size_t regressions = 0;
+};
+
+/*
+ * Prints every benchmark present in both runs with its change in time per op,
+ * and the ones present in only one of them.
+ */
+Comparison compare(const std::vector<BenchmarkResult> &baseline, const std::vector<BenchmarkResult> &current,
+                   double threshold_percent, std::ostream &output);
@@ -0,0 +1,566 @@
+// Benchmarks.cpp : Timings of hot paths. Build and run in Release.
+//
+//   Benchmarks [--filter text] [--repetitions n] [--json results.json]
+//       runs the benchmarks whose name contains text, optionally saving the results
+//   Benchmarks --compare baseline.json current.json [--threshold percent]
+//       exits with 1 if any benchmark got slower than the threshold (default 10%),
+//       with 2 if either file cannot be read or no benchmark is in both
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BenchmarkSuite.h"
+#include "../Math/Math.h"
+#include "../Math/Affine.h"
+#include "../Math/Arena.h"
+#include "../Math/BatchTransform.h"
+#include "../Math/RayPacket.h"
+#include "../Math/SphereSet.h"
+#include "../Math/Bvh.h"
+#include "../Renderer/Canvas.h"
+#include "../Renderer/PpmWriter.h"
+#include "../Renderer/Quantizer.h"
+
+using namespace rt_math;
+
+namespace
+{
+constexpr size_t iterations = 1'000'000;
+
+// 1080p, the size of a realistic frame
+constexpr unsigned int frame_width = 1920;
+constexpr unsigned int frame_height = 1080;
+
+void benchmark_tuples(BenchmarkSuite &suite)
+{
+    std::cout << "tuple" << std::endl;
+
+    // vary the input every iteration so nothing is hoisted out of the loop
+    const tuple a = vector(1, -2, 3);
+    suite.measure("tuple/operator+ operator- operator*", iterations, [&](const size_t i)
+    {
+        const tuple b = vector(static_cast<float>(i & 7), 1, 2);
+        return ((a + b) - b * 0.5f).x;
+    });
+    suite.measure("tuple/dot cross", iterations, [&](const size_t i)
+    {
+        const tuple b = vector(static_cast<float>(i & 7), 1, 2);
+        return dot(a, cross(a, b));
+    });
+    suite.measure("tuple/normalize", iterations, [&](const size_t i)
+    {
+        return normalize(vector(static_cast<float>(i & 7) + 1, 2, 3)).x;
+    });
+}
+
+void benchmark_matrices(BenchmarkSuite &suite)
+{
+    std::cout << std::endl << "Matrix<4>" << std::endl;
+
+    const Matrix<4> general = Matrix<4> {
+        -5,  2,  6, -8,
+         1, -5,  1,  8,
+         7,  7, -6, -7,
+         1, -3,  7,  4
+    };
+    const Matrix<4> affine = (translation(10, -3, 2) * rotation_y(0.7f) * scaling(2, 3, 4)).evaluate();
+
+    suite.measure("matrix/operator* matrix", iterations, [&](const size_t i)
+    {
+        const Matrix<4> m = (general * translation(static_cast<float>(i & 7), 0, 0)).evaluate();
+        return m.multiply(affine).at(1, 2);
+    });
+    suite.measure("matrix/operator* tuple", iterations, [&](const size_t i)
+    {
+        return (affine * point(static_cast<float>(i & 7), 1, 2)).y;
+    });
+
+    // the clock hand: three builders applied to one point
+    const double chain_fused = suite.measure("matrix/chain * tuple (fused first)", iterations, [&](const size_t i)
+    {
+        const Matrix<4> m = (translation(450, 250, 0) * rotation_z(static_cast<float>(i & 7)) * scaling(1, 150, 1)).evaluate();
+        return (m * point(0, 1, 0)).x;
+    });
+    const double chain_lazy = suite.measure("matrix/chain * tuple (lazy)", iterations, [&](const size_t i)
+    {
+        return (translation(450, 250, 0) * rotation_z(static_cast<float>(i & 7)) * scaling(1, 150, 1) * point(0, 1, 0)).x;
+    });
+
+    // includes the cost of building the input matrix
+    const double cofactor = suite.measure("matrix/cofactor_inverse (general)", iterations, [&](const size_t i)
+    {
+        const Matrix<4> m = (general * translation(static_cast<float>(i & 7), 0, 0)).evaluate();
+        return m.cofactor_inverse().at(0, 0);
+    });
+    const double closed_form = suite.measure("matrix/inverse (general, closed form)", iterations, [&](const size_t i)
+    {
+        const Matrix<4> m = (general * translation(static_cast<float>(i & 7), 0, 0)).evaluate();
+        return m.inverse().at(0, 0);
+    });
+    const double affine_cofactor = suite.measure("matrix/cofactor_inverse (affine)", iterations, [&](const size_t i)
+    {
+        const Matrix<4> m = (affine * translation(static_cast<float>(i & 7), 0, 0)).evaluate();
+        return m.cofactor_inverse().at(0, 3);
+    });
+    const double affine_closed_form = suite.measure("matrix/inverse (affine fast path)", iterations, [&](const size_t i)
+    {
+        const Matrix<4> m = (affine * translation(static_cast<float>(i & 7), 0, 0)).evaluate();
+        return m.inverse().at(0, 3);
+    });
+
+    const Affine affine_3x4 = Affine(affine);
+    // points come from memory and all components are used, as when moving a ray
+    tuple points[8];
+    for (size_t i = 0; i < 8; ++i)
+    {
+        points[i] = point(static_cast<float>(i), 1, 2);
+    }
+    const double full_tuple = suite.measure("matrix/Matrix<4> * tuple (affine)", iterations, [&](const size_t i)
+    {
+        const tuple p = affine * points[i & 7];
+        return p.x + p.y + p.z;
+    });
+    const double affine_tuple = suite.measure("matrix/Affine * tuple", iterations, [&](const size_t i)
+    {
+        const tuple p = affine_3x4 * points[i & 7];
+        return p.x + p.y + p.z;
+    });
+    const double full_product = suite.measure("matrix/Matrix<4> * Matrix<4> (affine)", iterations, [&](const size_t i)
+    {
+        return affine.multiply(translation(static_cast<float>(i & 7), 0, 0)).at(1, 3);
+    });
+    const double affine_product = suite.measure("matrix/Affine * Affine", iterations, [&](const size_t i)
+    {
+        return (affine_3x4 * Affine(translation(static_cast<float>(i & 7), 0, 0))).at(1, 3);
+    });
+
+    suite.report_speedup("lazy chain speedup", chain_fused, chain_lazy);
+    suite.report_speedup("affine tuple speedup", full_tuple, affine_tuple);
+    suite.report_speedup("affine product speedup", full_product, affine_product);
+    suite.report_speedup("closed form speedup", cofactor, closed_form);
+    suite.report_speedup("affine speedup", affine_cofactor, affine_closed_form);
+}
+
+void benchmark_batch_transform(BenchmarkSuite &suite)
+{
+    constexpr size_t count = 1 << 16;
+    std::cout << std::endl << "Batch transform, " << count << " points" << std::endl;
+
+    const Matrix<4> m = (translation(10, -3, 2) * rotation_y(0.7f) * scaling(2, 3, 4)).evaluate();
+    std::vector<tuple> points(count), transformed(count);
+    std::vector<float> x(count), y(count), z(count), w(count, 1.0f);
+    std::vector<float> out_x(count), out_y(count), out_z(count), out_w(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        points[i] = point(static_cast<float>(i % 1000), static_cast<float>(i % 7), -static_cast<float>(i % 13));
+        x[i] = points[i].x;
+        y[i] = points[i].y;
+        z[i] = points[i].z;
+    }
+    const TupleArrays<const float> in{ x, y, z, w };
+    const TupleArrays<float> out{ out_x, out_y, out_z, out_w };
+    const unsigned int threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+    // one iteration transforms every point
+    const double looped = suite.measure("transform/matrix * tuple loop", 200, [&](const size_t i)
+    {
+        for (size_t j = 0; j < count; ++j)
+        {
+            transformed[j] = m * points[j];
+        }
+        return transformed[i].x;
+    });
+    const double soa = suite.measure("transform/transform_tuples (SoA)", 200, [&](const size_t i)
+    {
+        transform_tuples(m, in, out);
+        return out_x[i];
+    });
+    const double threaded = suite.measure("transform/transform_tuples (SoA, all threads)", 200, [&](const size_t i)
+    {
+        transform_tuples(m, in, out, threads);
+        return out_x[i];
+    });
+
+    suite.report_speedup("SoA batch speedup", looped, soa);
+    suite.report_speedup("threaded SoA speedup", looped, threaded);
+}
+
+void benchmark_intersections(BenchmarkSuite &suite)
+{
+    std::cout << std::endl << "Sphere intersection, " << RayPacket::width << " rays" << std::endl;
+
+    Sphere sphere = Sphere();
+    sphere.set_transform(translation(0.5f, 0, 0) * scaling(2, 2, 2));
+    RayPacket packet;
+    for (size_t lane = 0; lane < RayPacket::width; ++lane)
+    {
+        packet.set(lane, Ray(point(0, static_cast<float>(lane) - 3.5f, -5), vector(0, 0, 1)));
+    }
+
+    const double single = suite.measure("sphere/Sphere::intersects x8", iterations, [&](const size_t i)
+    {
+        float sum = 0;
+        for (size_t lane = 0; lane < RayPacket::width; ++lane)
+        {
+            Intersections xs;
+            sphere.intersects(packet.ray((lane + i) & 7), xs);
+            sum += xs.empty() ? 0.0f : xs[0];
+        }
+        return sum;
+    });
+    const double packed = suite.measure("sphere/intersects(sphere, packet)", iterations, [&](const size_t i)
+    {
+        PacketHits hits;
+        intersects(sphere, packet, hits);
+        return hits.t0[i & 7] + static_cast<float>(hits.mask);
+    });
+
+    suite.report_speedup("packet speedup", single, packed);
+}
+
+void benchmark_closest_hit(BenchmarkSuite &suite)
+{
+    constexpr size_t sphere_count = 10'000;
+    std::cout << std::endl << "Closest hit, " << sphere_count << " spheres" << std::endl;
+
+    std::vector<Sphere> spheres(sphere_count);
+    SphereSet sphere_set;
+    for (size_t i = 0; i < sphere_count; ++i)
+    {
+        spheres[i].set_transform(translation(static_cast<float>(i % 100) * 3, static_cast<float>(i / 100) * 3, 10) * scaling(0.5f, 0.5f, 0.5f));
+        sphere_set.push_back(spheres[i]);
+    }
+
+    const double looped = suite.measure("closest hit/loop over Sphere::intersects", 1'000, [&](const size_t i)
+    {
+        const Ray ray = Ray(point(static_cast<float>(i % 100) * 3, 0, 0), vector(0, 0, 1));
+        float closest = std::numeric_limits<float>::infinity();
+        for (const Sphere &s : spheres)
+        {
+            Intersections xs;
+            s.intersects(ray, xs);
+            for (size_t k = 0; k < xs.size(); ++k)
+            {
+                if (xs[k] >= 0 && xs[k] < closest) closest = xs[k];
+            }
+        }
+        return closest;
+    });
+    const double set = suite.measure("closest hit/SphereSet::closest_hit", 1'000, [&](const size_t i)
+    {
+        const Ray ray = Ray(point(static_cast<float>(i % 100) * 3, 0, 0), vector(0, 0, 1));
+        return sphere_set.closest_hit(ray).t;
+    });
+
+    const Bvh bvh(spheres);
+    const double tree = suite.measure("closest hit/Bvh::closest_hit", 1'000, [&](const size_t i)
+    {
+        const Ray ray = Ray(point(static_cast<float>(i % 100) * 3, 0, 0), vector(0, 0, 1));
+        return bvh.closest_hit(ray).t;
+    });
+
+    suite.report_speedup("sphere set speedup", looped, set);
+    suite.report_speedup("bvh speedup", looped, tree);
+}
+
+void benchmark_arena(BenchmarkSuite &suite)
+{
+    // every ray collects the hits of every sphere, as a shader gathering all intersections would
+    constexpr size_t sphere_count = 32;
+    constexpr size_t rays_per_thread = 1024;
+    constexpr size_t rays_per_tile = 64;
+    const unsigned int threads = std::max(std::thread::hardware_concurrency(), 4u);
+    std::cout << std::endl << "Intersection lists, " << sphere_count << " spheres, "
+              << threads << " threads x " << rays_per_thread << " rays" << std::endl;
+
+    std::vector<Sphere> spheres(sphere_count);
+    for (size_t i = 0; i < sphere_count; ++i)
+    {
+        spheres[i].set_transform(translation(0, 0, static_cast<float>(i) * 3));
+    }
+
+    // one iteration runs every thread over its rays and sums the nearest hits
+    const auto on_threads = [&](const auto &trace)
+    {
+        std::vector<float> sums(threads);
+        std::vector<std::thread> workers;
+        for (unsigned int t = 0; t < threads; ++t)
+        {
+            workers.emplace_back([&, t]()
+            {
+                // where the thread's arena was before its rays, as before a frame
+                const Arena::Mark before_tiles = thread_arena().mark();
+                float sum = 0;
+                for (size_t r = 0; r < rays_per_thread; ++r)
+                {
+                    sum += trace(Ray(point(static_cast<float>(r & 7) * 0.1f, 0, -5), vector(0, 0, 1)), r, before_tiles);
+                }
+                sums[t] = sum;
+            });
+        }
+        for (std::thread &worker : workers)
+        {
+            worker.join();
+        }
+        return sums[0];
+    };
+
+    const double heap = suite.measure("arena/intersection lists, std::vector", 100, [&](size_t)
+    {
+        return on_threads([&](const Ray &ray, size_t, Arena::Mark)
+        {
+            std::vector<float> all;
+            for (const Sphere &sphere : spheres)
+            {
+                const std::vector<float> xs = sphere.intersects(ray);
+                all.insert(all.end(), xs.begin(), xs.end());
+            }
+            return all.empty() ? 0.0f : all.front();
+        });
+    });
+    const double arena = suite.measure("arena/intersection lists, thread arena", 100, [&](size_t)
+    {
+        return on_threads([&](const Ray &ray, const size_t r, const Arena::Mark before_tiles)
+        {
+            ArenaVector<float> all{ ArenaAllocator<float>(thread_arena()) };
+            for (const Sphere &sphere : spheres)
+            {
+                sphere.intersects(ray, all);
+            }
+            const float nearest = all.empty() ? 0.0f : all.front();
+            // as the tile renderer does after every tile
+            if (r % rays_per_tile == rays_per_tile - 1)
+            {
+                thread_arena().rewind(before_tiles);
+            }
+            return nearest;
+        });
+    });
+
+    suite.report_speedup("arena speedup", heap, arena);
+}
+
+void benchmark_canvas(BenchmarkSuite &suite)
+{
+    std::cout << std::endl << "Canvas, " << frame_width << "x" << frame_height << std::endl;
+
+    // per pixel, over a whole frame
+    Canvas frame(frame_width, frame_height);
+    suite.measure("canvas/write_pixel", 20, [&](const size_t i)
+    {
+        const color pixel(static_cast<float>(i), 0, 1);
+        for (unsigned int y = 0; y < frame_height; ++y)
+        {
+            for (unsigned int x = 0; x < frame_width; ++x)
+            {
+                frame.write_pixel(x, y, pixel);
+            }
+        }
+        return frame.pixel_at(i % frame_width, 0).red;
+    });
+
+    // 5x5 box filter, every pixel reads a neighbourhood reaching two rows up and down
+    constexpr unsigned int canvas_size = 2048;
+    const auto box_filter = [](const Canvas &canvas)
+    {
+        float total = 0;
+        canvas.for_each_pixel([&](const unsigned int x, const unsigned int y, const color &)
+        {
+            const unsigned int x0 = x < 2 ? 0 : x - 2, x1 = std::min(x + 2, canvas.width - 1);
+            const unsigned int y0 = y < 2 ? 0 : y - 2, y1 = std::min(y + 2, canvas.height - 1);
+            for (unsigned int ny = y0; ny <= y1; ++ny)
+            {
+                for (unsigned int nx = x0; nx <= x1; ++nx)
+                {
+                    total += canvas.pixel_at(nx, ny).red;
+                }
+            }
+        });
+        return total;
+    };
+
+    const Canvas row_major(canvas_size, canvas_size);
+    const Canvas tiled(canvas_size, canvas_size, CanvasLayout::Tiled);
+    const double row_major_filter = suite.measure("canvas/5x5 box filter 2048x2048, row major", 1, [&](size_t) { return box_filter(row_major); });
+    const double tiled_filter = suite.measure("canvas/5x5 box filter 2048x2048, tiled", 1, [&](size_t) { return box_filter(tiled); });
+
+    suite.report_speedup("tiled layout speedup", row_major_filter, tiled_filter);
+}
+
+void benchmark_output(BenchmarkSuite &suite)
+{
+    std::cout << std::endl << "Output, " << frame_width << "x" << frame_height << std::endl;
+
+    std::vector<color> frame(static_cast<size_t>(frame_width) * frame_height);
+    Canvas canvas(frame_width, frame_height);
+    for (size_t i = 0; i < frame.size(); ++i)
+    {
+        const float value = static_cast<float>(i % 1000) / 800.0f;
+        frame[i] = color(value, 1.0f - value, value * 0.5f);
+        canvas.write_pixel(static_cast<unsigned int>(i % frame_width), static_cast<unsigned int>(i / frame_width), frame[i]);
+    }
+    std::vector<unsigned char> bytes(frame.size() * 3);
+
+    const double per_channel = suite.measure("output/round + clamp per channel", 20, [&](size_t)
+    {
+        const auto to_byte = [](const float channel)
+        {
+            const unsigned int value = channel > 0 ? static_cast<unsigned int>(round(channel * 255.0f)) : 0;
+            return static_cast<unsigned char>(value > 255 ? 255 : value);
+        };
+        for (size_t i = 0; i < frame.size(); ++i)
+        {
+            bytes[i * 3] = to_byte(frame[i].red);
+            bytes[i * 3 + 1] = to_byte(frame[i].green);
+            bytes[i * 3 + 2] = to_byte(frame[i].blue);
+        }
+        return static_cast<float>(bytes[bytes.size() / 2]);
+    });
+
+    const Quantizer quantizer;
+    const double bulk = suite.measure("output/Quantizer::to_rgb8", 20, [&](size_t)
+    {
+        quantizer.to_rgb8(frame.data(), frame.size(), bytes.data());
+        return static_cast<float>(bytes[bytes.size() / 2]);
+    });
+
+    ToneMapping tone_mapped;
+    tone_mapped.curve = ToneCurve::Reinhard;
+    tone_mapped.gamma = 2.2f;
+    const Quantizer gamma_quantizer(tone_mapped);
+    suite.measure("output/Quantizer::to_rgb8, Reinhard + gamma", 20, [&](size_t)
+    {
+        gamma_quantizer.to_rgb8(frame.data(), frame.size(), bytes.data());
+        return static_cast<float>(bytes[bytes.size() / 2]);
+    });
+
+    suite.report_speedup("quantizer speedup", per_channel, bulk);
+
+    // includes the file system, as users see it
+    const std::string file_name = "benchmark_output.ppm";
+    const PpmWriter p3(file_name, PpmFormat::P3);
+    const PpmWriter p6(file_name, PpmFormat::P6);
+    suite.measure("output/PpmWriter::canvas_to_ppm P3", 1, [&](size_t)
+    {
+        p3.canvas_to_ppm(&canvas);
+        return 0.0f;
+    });
+    suite.measure("output/PpmWriter::canvas_to_ppm P6", 5, [&](size_t)
+    {
+        p6.canvas_to_ppm(&canvas);
+        return 0.0f;
+    });
+    std::remove(file_name.c_str());
+}
+
+std::optional<std::vector<BenchmarkResult>> read_results(const std::string &file_name)
+{
+    std::ifstream input(file_name);
+    if (!input.is_open())
+    {
+        std::cerr << "Unable to open " << file_name << std::endl;
+        return std::nullopt;
+    }
+
+    std::optional<std::vector<BenchmarkResult>> results = read_json(input);
+    if (!results)
+    {
+        std::cerr << file_name << " is not a benchmark results file" << std::endl;
+    }
+    return results;
+}
+
+void print_usage()
+{
+    std::cerr << "usage: Benchmarks [--filter text] [--repetitions n] [--json results.json]" << std::endl
+              << "       Benchmarks --compare baseline.json current.json [--threshold percent]" << std::endl;
+}
+
+// the whole of text as a number, nothing if it is not one
+std::optional<double> parse_number(const std::string &text)
+{
+    size_t length = 0;
+    try
+    {
+        const double value = std::stod(text, &length);
+        if (length == text.size() && std::isfinite(value))
+        {
+            return value;
+        }
+    }
+    catch (const std::exception &)
+    {
+    }
+    return std::nullopt;
+}
+}
+
+int main(const int argc, char *argv[])
+{
+    const std::vector<std::string> arguments(argv + 1, argv + argc);
+    const auto option = [&](const std::string &name, const std::string &fallback)
+    {
+        const auto found = std::find(arguments.begin(), arguments.end(), name);
+        return found != arguments.end() && found + 1 != arguments.end() ? *(found + 1) : fallback;
+    };
+
+    const auto compare_at = std::find(arguments.begin(), arguments.end(), "--compare");
+    if (compare_at != arguments.end())
+    {
+        const std::optional<double> threshold = parse_number(option("--threshold", "10"));
+        if (arguments.end() - compare_at < 3 || !threshold || *threshold < 0)
+        {
+            print_usage();
+            return 2;
+        }
+
+        // a gate that cannot read either run must not pass
+        const std::optional<std::vector<BenchmarkResult>> baseline = read_results(*(compare_at + 1));
+        const std::optional<std::vector<BenchmarkResult>> current = read_results(*(compare_at + 2));
+        if (!baseline || !current)
+        {
+            return 2;
+        }
+
+        const Comparison comparison = compare(*baseline, *current, *threshold, std::cout);
+        if (comparison.compared == 0)
+        {
+            std::cerr << std::endl << "No benchmark is in both runs, nothing was compared" << std::endl;
+            return 2;
+        }
+
+        std::cout << std::endl << comparison.regressions << " regression(s) beyond " << *threshold << "%" << std::endl;
+        return comparison.regressions == 0 ? 0 : 1;
+    }
+
+    const std::optional<double> repetitions = parse_number(option("--repetitions", "3"));
+    if (!repetitions || *repetitions < 1 || *repetitions != std::floor(*repetitions))
+    {
+        print_usage();
+        return 2;
+    }
+
+    BenchmarkSuite suite(option("--filter", ""), static_cast<size_t>(*repetitions));
+    benchmark_tuples(suite);
+    benchmark_matrices(suite);
+    benchmark_batch_transform(suite);
+    benchmark_intersections(suite);
+    benchmark_closest_hit(suite);
+    benchmark_arena(suite);
+    benchmark_canvas(suite);
+    benchmark_output(suite);
+
+    const std::string json_file = option("--json", "");
+    if (!json_file.empty())
+    {
+        std::ofstream output(json_file);
+        suite.write_json(output);
+        std::cout << std::endl << "Results written to " << json_file << std::endl;
+    }
+}
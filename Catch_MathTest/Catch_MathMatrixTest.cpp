@@ -3,6 +3,11 @@
 #pragma warning(pop)
 
 #include "../Math/Math.h"
+#include "../Math/Transform.h"
+#include "../Math/BatchTransform.h"
+#include <atomic>
+#include <stdexcept>
+#include <vector>
 
 using namespace rt_math;
 
@@ -176,6 +181,37 @@ SCENARIO("Multiplying the identity matrix by a tuple", "[matrix]")
     }
 }
 
+SCENARIO("Matrix chains are evaluated lazily", "[matrix]")
+{
+    GIVEN("a chain of three transformations")
+    {
+        // stored lazily on purpose; code that reuses a chain stores its evaluate() instead
+        const auto chain = translation(10, 5, 7) * rotation_z(0.3f) * scaling(2, 3, 4);
+        const Matrix<4> fused = translation(10, 5, 7).multiply(rotation_z(0.3f)).multiply(scaling(2, 3, 4));
+
+        THEN("applying it to a tuple right to left matches the fused matrix")
+        {
+            const tuple p = point(1, -2, 3);
+
+            REQUIRE(chain * p == fused * p);
+            REQUIRE(chain == fused);
+            REQUIRE(fused == chain);
+        }
+
+        THEN("it converts to a matrix wherever one is expected")
+        {
+            const Matrix<4> converted = chain;
+            const Transform transform = chain;
+
+            REQUIRE(converted == fused);
+            REQUIRE(transform.inverse() == fused.inverse());
+            REQUIRE(chain.inverse() == fused.inverse());
+            REQUIRE(transpose(chain) == transpose(fused));
+            REQUIRE((chain * rt_math::identity_matrix) * point(0, 0, 0) == point(10, 5, 7));
+        }
+    }
+}
+
 SCENARIO("Transposing a matrix", "[matrix]")
 {
     GIVEN("Matrix A")
@@ -458,4 +494,122 @@ SCENARIO("Multiplying a product by its inverse", "[matrix]")
     }
 }
 
+SCENARIO("Closed form inverse agrees with cofactor expansion", "[matrix]")
+{
+	GIVEN("4x4 matrix A that is not affine")
+	{
+		const Matrix<4> A = Matrix<4> {
+			-5,  2,  6, -8,
+			 1, -5,  1,  8,
+			 7,  7, -6, -7,
+			 1, -3,  7,  4
+		};
+
+		REQUIRE_FALSE(A.is_affine());
+		REQUIRE(A.inverse() == A.cofactor_inverse());
+	}
+
+	GIVEN("affine transform T")
+	{
+		const Matrix<4> T = translation(10, -3, 2) * rotation_y(0.7f) * scaling(2, 3, 4) * shearing(1, 0, 0, 0, 0, 1);
+
+		REQUIRE(T.is_affine());
+		REQUIRE(T.affine_inverse() == T.cofactor_inverse());
+		REQUIRE(T * T.inverse() == Matrix<4>::identity_matrix());
+	}
+}
+
+SCENARIO("Batches of tuples are transformed like single tuples", "[matrix]")
+{
+	GIVEN("transform T and an odd number of points and vectors, enough for several threads")
+	{
+		const Matrix<4> T = translation(10, -3, 2) * rotation_y(0.7f) * scaling(2, 3, 4);
+
+		constexpr size_t count = 40003;
+		std::vector<tuple> tuples(count);
+		std::vector<float> x(count), y(count), z(count), w(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			const float f = static_cast<float>(i % 100);
+			tuples[i] = i % 2 == 0 ? point(f, -f, 1) : vector(1, f, f * 0.5f);
+			x[i] = tuples[i].x;
+			y[i] = tuples[i].y;
+			z[i] = tuples[i].z;
+			w[i] = tuples[i].w;
+		}
+
+		const auto matches = [&](const std::vector<tuple> &result)
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				if (result[i] != T * tuples[i])
+				{
+					return false;
+				}
+			}
+			return true;
+		};
+
+		WHEN("they are transformed as component arrays into other arrays on one thread")
+		{
+			std::vector<float> out_x(count), out_y(count), out_z(count), out_w(count);
+			transform_tuples(T, TupleArrays<const float>{ x, y, z, w }, TupleArrays<float>{ out_x, out_y, out_z, out_w });
+
+			THEN("every result is T times its tuple")
+			{
+				std::vector<tuple> result(count);
+				for (size_t i = 0; i < count; ++i)
+				{
+					result[i] = tuple{ out_x[i], out_y[i], out_z[i], out_w[i] };
+				}
+				REQUIRE(matches(result));
+			}
+		}
+
+		WHEN("they are transformed in place as component arrays on four threads")
+		{
+			transform_tuples(T, TupleArrays<const float>{ x, y, z, w }, TupleArrays<float>{ x, y, z, w }, 4);
+
+			THEN("every result is T times its tuple")
+			{
+				std::vector<tuple> result(count);
+				for (size_t i = 0; i < count; ++i)
+				{
+					result[i] = tuple{ x[i], y[i], z[i], w[i] };
+				}
+				REQUIRE(matches(result));
+			}
+		}
+	}
+}
+
+SCENARIO("A chunk that throws on another thread reaches the caller", "[matrix]")
+{
+	GIVEN("enough elements for four chunks")
+	{
+		constexpr size_t count = min_elements_per_thread * 4;
+		REQUIRE(chunk_threads(count, 4) == 4);
 
+		WHEN("the last chunk throws")
+		{
+			std::atomic<size_t> done{ 0 };
+			const auto run = [&done]
+			{
+				for_each_chunk(count, 4, [&done](const size_t begin, const size_t end)
+				{
+					if (end == count)
+					{
+						throw std::runtime_error("last chunk failed");
+					}
+					done += end - begin;
+				});
+			};
+
+			THEN("it is rethrown once the other chunks are done")
+			{
+				REQUIRE_THROWS_WITH(run(), "last chunk failed");
+				REQUIRE(done == count - chunk_size(count, 4));
+			}
+		}
+	}
+}
@@ -1,6 +1,18 @@
 #include <catch2/catch.hpp>
 #include "../Math/Math.h"
 #include "../Math/Geometry.h"
+#include "../Math/RayPacket.h"
+#include "../Math/SphereSet.h"
+#include "../Math/Bvh.h"
+#include "../Math/Stats.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 using namespace rt_math;
 
@@ -15,8 +27,40 @@ SCENARIO("Creating and querying a ray")
         {
             const Ray r = Ray(origin, direction);
 
-            REQUIRE(origin == r.origin);
-            REQUIRE(direction == r.direction);
+            REQUIRE(origin == r.origin());
+            REQUIRE(direction == r.direction());
+        }
+    }
+}
+
+SCENARIO("Rays and spheres are plain values")
+{
+    STATIC_REQUIRE(std::is_trivially_copyable_v<Ray>);
+    STATIC_REQUIRE(std::is_trivially_copyable_v<Sphere>);
+    STATIC_REQUIRE(sizeof(Ray) == 32);
+
+    GIVEN("rays in a flat buffer")
+    {
+        std::vector<Ray> rays;
+        for (int i = 0; i < 100; ++i)
+        {
+            rays.emplace_back(point(static_cast<float>(i), 0, 0), vector(0, 0, 1));
+        }
+
+        WHEN("the buffer is copied byte for byte and a ray is assigned over another")
+        {
+            std::vector<Ray> copy(rays.size(), Ray(point(0, 0, 0), vector(0, 0, 0)));
+            std::memcpy(copy.data(), rays.data(), rays.size() * sizeof(Ray));
+            copy[0] = copy[99];
+
+            THEN("every copy holds its own origin and direction")
+            {
+                rays.clear();
+
+                REQUIRE(copy[0].origin() == point(99, 0, 0));
+                REQUIRE(copy[42].origin() == point(42, 0, 0));
+                REQUIRE(copy[42].direction() == vector(0, 0, 1));
+            }
         }
     }
 }
@@ -120,3 +164,444 @@ SCENARIO("A sphere is behind a ray")
         }
     }
 }
+
+SCENARIO("Intersecting into a stack hit record", "[intersection]")
+{
+    GIVEN("sphere and ray")
+    {
+        const Ray ray = Ray(point(0, 0, -5), vector(0, 0, 1));
+        const Sphere sphere = Sphere();
+
+        WHEN("intersects(sphere, ray, xs)")
+        {
+            Intersections xs;
+            sphere.intersects(ray, xs);
+
+            REQUIRE(xs.size() == 2);
+            REQUIRE(xs[0] == 4.0f);
+            REQUIRE(xs[1] == 6.0f);
+
+            AND_WHEN("the same record is reused for a miss")
+            {
+                sphere.intersects(Ray(point(0, 2, -5), vector(0, 0, 1)), xs);
+
+                REQUIRE(xs.empty());
+            }
+        }
+    }
+}
+
+SCENARIO("Translating a ray")
+{
+    GIVEN("r <- ray(point(1, 2, 3), vector(0, 1, 0)) and m <- translation(3, 4, 5)")
+    {
+        const Ray r = Ray(point(1, 2, 3), vector(0, 1, 0));
+        const Matrix<4> m = translation(3, 4, 5);
+
+        const Ray r2 = transform(r, m);
+
+        REQUIRE(r2.origin() == point(4, 6, 8));
+        REQUIRE(r2.direction() == vector(0, 1, 0));
+    }
+}
+
+SCENARIO("Scaling a ray")
+{
+    GIVEN("r <- ray(point(1, 2, 3), vector(0, 1, 0)) and m <- scaling(2, 3, 4)")
+    {
+        const Ray r = Ray(point(1, 2, 3), vector(0, 1, 0));
+        const Matrix<4> m = scaling(2, 3, 4);
+
+        const Ray r2 = transform(r, m);
+
+        REQUIRE(r2.origin() == point(2, 6, 12));
+        REQUIRE(r2.direction() == vector(0, 3, 0));
+    }
+}
+
+SCENARIO("A sphere's default transformation")
+{
+    const Sphere s = Sphere();
+
+    REQUIRE(s.transformation().matrix() == Matrix<4>::identity_matrix());
+}
+
+SCENARIO("Intersecting a scaled sphere with a ray")
+{
+    GIVEN("sphere and ray")
+    {
+        const Ray ray = Ray(point(0, 0, -5), vector(0, 0, 1));
+        Sphere sphere = Sphere();
+
+        WHEN("set_transform(s, scaling(2, 2, 2))")
+        {
+            sphere.set_transform(scaling(2, 2, 2));
+            const std::vector<float> xs = sphere.intersects(ray);
+
+            REQUIRE(xs.size() == 2);
+            REQUIRE(eq_f(xs[0], 3.0f));
+            REQUIRE(eq_f(xs[1], 7.0f));
+        }
+    }
+}
+
+SCENARIO("Intersecting a translated sphere with a ray")
+{
+    GIVEN("sphere and ray")
+    {
+        const Ray ray = Ray(point(0, 0, -5), vector(0, 0, 1));
+        Sphere sphere = Sphere();
+
+        WHEN("set_transform(s, translation(5, 0, 0))")
+        {
+            sphere.set_transform(translation(5, 0, 0));
+            const std::vector<float> xs = sphere.intersects(ray);
+
+            REQUIRE(xs.empty());
+        }
+    }
+}
+
+SCENARIO("A ray packet intersects a sphere lane by lane")
+{
+    GIVEN("a transformed sphere and 8 rays, some missing")
+    {
+        Sphere sphere = Sphere();
+        sphere.set_transform(translation(0.5f, 0, 0) * scaling(2, 2, 2));
+
+        RayPacket packet;
+        for (size_t lane = 0; lane < RayPacket::width; ++lane)
+        {
+            // y from -3.5 to 3.5, sphere spans -2 to 2
+            packet.set(lane, Ray(point(0, static_cast<float>(lane) - 3.5f, -5), vector(0, 0, 1)));
+        }
+
+        WHEN("intersects(sphere, packet, hits)")
+        {
+            PacketHits hits;
+            intersects(sphere, packet, hits);
+
+            THEN("every lane matches the single ray intersection")
+            {
+                for (size_t lane = 0; lane < RayPacket::width; ++lane)
+                {
+                    Intersections xs;
+                    sphere.intersects(packet.ray(lane), xs);
+
+                    REQUIRE(hits.hit(lane) == !xs.empty());
+                    if (!xs.empty())
+                    {
+                        REQUIRE(eq_f(hits.t0[lane], xs[0]));
+                        REQUIRE(eq_f(hits.t1[lane], xs[1]));
+                    }
+                }
+                REQUIRE(hits.mask == 0b00111100);
+            }
+        }
+    }
+}
+
+SCENARIO("A sphere set finds the same closest hit as looping over spheres")
+{
+    GIVEN("a row of 11 spheres, and the same spheres in a set")
+    {
+        std::vector<Sphere> spheres(11);
+        SphereSet set;
+        for (size_t i = 0; i < spheres.size(); ++i)
+        {
+            const float offset = static_cast<float>(i);
+            spheres[i].set_transform(translation(offset * 1.5f - 7.5f, 0, offset) * scaling(0.5f, 0.5f, 0.5f));
+            set.push_back(spheres[i]);
+        }
+
+        THEN("every ray agrees with the brute force lowest non negative t")
+        {
+            for (int step = -40; step <= 40; ++step)
+            {
+                const Ray ray = Ray(point(static_cast<float>(step) * 0.25f, 0.1f, -5), vector(0, 0, 1));
+
+                size_t expected_index = SphereHit::none;
+                float expected_t = std::numeric_limits<float>::infinity();
+                for (size_t i = 0; i < spheres.size(); ++i)
+                {
+                    Intersections xs;
+                    spheres[i].intersects(ray, xs);
+                    for (size_t k = 0; k < xs.size(); ++k)
+                    {
+                        if (xs[k] >= 0 && xs[k] < expected_t)
+                        {
+                            expected_t = xs[k];
+                            expected_index = i;
+                        }
+                    }
+                }
+
+                const SphereHit hit = set.closest_hit(ray);
+                REQUIRE(hit.index == expected_index);
+                if (hit.hit())
+                {
+                    REQUIRE(eq_f(hit.t, expected_t));
+                }
+            }
+        }
+
+        THEN("a ray starting inside a sphere hits its far side")
+        {
+            const SphereHit hit = set.closest_hit(Ray(point(-7.5f, 0, 0), vector(0, 0, 1)));
+
+            REQUIRE(hit.index == 0);
+            REQUIRE(eq_f(hit.t, 0.5f));
+        }
+    }
+}
+
+SCENARIO("Bounds of a transformed sphere")
+{
+    GIVEN("sphere scaled by 2 and moved to (5, 0, 0)")
+    {
+        Sphere sphere = Sphere();
+        sphere.set_transform(translation(5, 0, 0) * scaling(2, 2, 2));
+
+        const Bounds box = bounds(sphere);
+
+        REQUIRE(eq_f(box.min[0], 3));
+        REQUIRE(eq_f(box.max[0], 7));
+        REQUIRE(eq_f(box.min[1], -2));
+        REQUIRE(eq_f(box.max[2], 2));
+    }
+}
+
+SCENARIO("A BVH finds the same closest hit as looping over spheres")
+{
+    GIVEN("a scattered cloud of 500 spheres")
+    {
+        // fixed linear congruential sequence, same scene every run
+        uint32_t seed = 12345;
+        const auto random = [&seed]()
+        {
+            seed = seed * 1664525u + 1013904223u;
+            return static_cast<float>(seed >> 8) / static_cast<float>(1 << 24);
+        };
+
+        std::vector<Sphere> spheres(500);
+        for (Sphere &sphere : spheres)
+        {
+            const float radius = 0.1f + random() * 0.4f;
+            sphere.set_transform(
+                translation(random() * 40 - 20, random() * 40 - 20, random() * 40) *
+                scaling(radius, radius, radius));
+        }
+
+        const Bvh bvh(spheres);
+
+        THEN("the tree is much smaller than one leaf per sphere")
+        {
+            REQUIRE(bvh.nodes().size() < 2 * spheres.size());
+        }
+
+        THEN("every ray agrees with brute force")
+        {
+            for (int i = 0; i < 400; ++i)
+            {
+                const Ray ray = Ray(
+                    point(random() * 40 - 20, random() * 40 - 20, -10),
+                    vector(random() - 0.5f, random() - 0.5f, 1));
+
+                SphereHit expected;
+                for (size_t k = 0; k < spheres.size(); ++k)
+                {
+                    Intersections xs;
+                    spheres[k].intersects(ray, xs);
+                    for (size_t j = 0; j < xs.size(); ++j)
+                    {
+                        if (xs[j] >= 0 && xs[j] < expected.t)
+                        {
+                            expected.t = xs[j];
+                            expected.index = k;
+                        }
+                    }
+                }
+
+                const SphereHit hit = bvh.closest_hit(ray);
+                REQUIRE(hit.index == expected.index);
+                REQUIRE(hit.t == expected.t);
+            }
+        }
+    }
+}
+
+SCENARIO("A BVH stays shallow and split up whatever the scene's extent")
+{
+    GIVEN("200 unit spheres at exponentially growing distances along the diagonal, out to 1e35")
+    {
+        std::vector<Sphere> spheres(200);
+        std::vector<float> x(spheres.size());
+        for (size_t i = 0; i < spheres.size(); ++i)
+        {
+            x[i] = std::pow(1.5f, static_cast<float>(i));
+            spheres[i].set_transform(translation(x[i], x[i], x[i]));
+        }
+
+        const Bvh bvh(spheres);
+
+        THEN("no path is deeper than max_depth and no leaf holds more than max_leaf_size spheres")
+        {
+            const std::vector<Bvh::Node> &nodes = bvh.nodes();
+            size_t deepest = 0;
+            size_t largest_leaf = 0;
+            std::vector<std::pair<uint32_t, size_t>> pending = { { 0, 0 } };
+            while (!pending.empty())
+            {
+                const auto [index, depth] = pending.back();
+                pending.pop_back();
+                deepest = std::max(deepest, depth);
+                if (nodes[index].count > 0)
+                {
+                    largest_leaf = std::max<size_t>(largest_leaf, nodes[index].count);
+                    continue;
+                }
+                pending.emplace_back(index + 1, depth + 1);
+                pending.emplace_back(nodes[index].offset, depth + 1);
+            }
+
+            REQUIRE(deepest <= Bvh::max_depth);
+            REQUIRE(largest_leaf <= Bvh::max_leaf_size);
+        }
+
+        THEN("rays at near and far spheres find them")
+        {
+            for (const size_t i : { size_t(0), size_t(50), size_t(120), size_t(199) })
+            {
+                const SphereHit hit = bvh.closest_hit(Ray(point(x[i], x[i], x[i] - 10), vector(0, 0, 1)));
+                REQUIRE(hit.index == i);
+            }
+        }
+    }
+}
+
+SCENARIO("Intersection tests are counted")
+{
+    GIVEN("cleared statistics and a unit sphere")
+    {
+        rt_math::stats::reset();
+        const Sphere s;
+
+        WHEN("one ray hits and two miss")
+        {
+            Intersections xs;
+            s.intersects(Ray(point(0, 0, -5), vector(0, 0, 1)), xs);
+            s.intersects(Ray(point(0, 2, -5), vector(0, 0, 1)), xs);
+            s.intersects(Ray(point(0, 2, -5), vector(0, 0, 1)), xs);
+
+            THEN("the calling thread's counters show them")
+            {
+                const rt_math::stats::Counters counters = rt_math::stats::collect();
+                REQUIRE(counters.intersection_tests == 3);
+                REQUIRE(counters.hits == 1);
+                REQUIRE(counters.misses() == 2);
+            }
+        }
+
+        WHEN("another thread that flushed once tests the sphere and exits")
+        {
+            std::thread other([&s]()
+            {
+                rt_math::stats::flush();
+                Intersections xs;
+                s.intersects(Ray(point(0, 0, -5), vector(0, 0, 1)), xs);
+            });
+            other.join();
+
+            THEN("its last counts were merged on exit")
+            {
+                REQUIRE(rt_math::stats::collect().hits == 1);
+            }
+        }
+    }
+}
+
+SCENARIO("Intersections of many spheres are collected in an arena")
+{
+    GIVEN("an arena with small blocks and three spheres along the z axis")
+    {
+        Arena arena(256);
+        std::vector<Sphere> spheres(3);
+        for (size_t i = 0; i < spheres.size(); ++i)
+        {
+            spheres[i].set_transform(translation(0, 0, static_cast<float>(i) * 3));
+        }
+        const Ray ray = Ray(point(0, 0, -5), vector(0, 0, 1));
+
+        WHEN("the hits of every sphere are appended to one list, for several pixels in a row")
+        {
+            size_t capacity_after_first = 0;
+            for (int pixel = 0; pixel < 10; ++pixel)
+            {
+                ArenaVector<float> xs{ ArenaAllocator<float>(arena) };
+                for (const Sphere &sphere : spheres)
+                {
+                    sphere.intersects(ray, xs);
+                }
+
+                const float expected[] = { 4, 6, 7, 9, 10, 12 };
+                REQUIRE(xs.size() == 6);
+                for (size_t k = 0; k < xs.size(); ++k)
+                {
+                    REQUIRE(xs[k] == Approx(expected[k]));
+                }
+                arena.reset();
+
+                if (pixel == 0)
+                {
+                    capacity_after_first = arena.capacity();
+                }
+            }
+
+            THEN("the arena's memory is reused rather than grown")
+            {
+                REQUIRE(capacity_after_first > 0);
+                REQUIRE(arena.capacity() == capacity_after_first);
+            }
+        }
+
+        WHEN("an arena is rewound to a mark taken after a first allocation, across several blocks")
+        {
+            int *kept = arena.allocate<int>(4);
+            kept[3] = 42;
+            const Arena::Mark mark = arena.mark();
+
+            for (int round = 0; round < 3; ++round)
+            {
+                for (int i = 0; i < 10; ++i)
+                {
+                    float *scratch = arena.allocate<float>(50);
+                    std::fill(scratch, scratch + 50, -1.0f);
+                }
+                arena.rewind(mark);
+            }
+            const size_t capacity = arena.capacity();
+            int *next = arena.allocate<int>(1);
+
+            THEN("what was allocated before the mark survives and the memory after it is reused")
+            {
+                REQUIRE(kept[3] == 42);
+                REQUIRE(next == kept + 4);
+                REQUIRE(arena.capacity() == capacity);
+            }
+        }
+
+        WHEN("allocations are larger than a block and over-aligned")
+        {
+            double *large = arena.allocate<double>(100);
+            auto *aligned = static_cast<std::byte *>(arena.allocate(16, 64));
+            large[99] = 1.5;
+
+            THEN("each gets its own memory, aligned as asked")
+            {
+                REQUIRE(large[99] == 1.5);
+                REQUIRE(reinterpret_cast<uintptr_t>(aligned) % 64 == 0);
+                REQUIRE(reinterpret_cast<uintptr_t>(large) % alignof(double) == 0);
+            }
+        }
+    }
+}
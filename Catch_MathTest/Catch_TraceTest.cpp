@@ -0,0 +1,64 @@
+// tracing is compiled out unless RT_TRACE is defined, so this file turns it on for itself
+#ifndef RT_TRACE
+#define RT_TRACE
+#endif
+
+#include <catch2/catch.hpp>
+#include "../Math/Trace.h"
+#include <sstream>
+#include <string>
+#include <thread>
+
+SCENARIO("Scopes are recorded per thread and exported as trace events")
+{
+    GIVEN("no recorded events")
+    {
+        rt_math::trace::clear();
+
+        WHEN("a named thread and another thread each leave a scope")
+        {
+            {
+                RT_TRACE_THREAD_NAME("test \"main\"");
+                RT_TRACE_SCOPE("outer");
+            }
+            std::thread other([]()
+            {
+                RT_TRACE_SCOPE("other");
+            });
+            other.join();
+
+            THEN("both events are in the export, with the thread name escaped")
+            {
+                REQUIRE(rt_math::trace::event_count() == 2);
+
+                std::ostringstream output;
+                rt_math::trace::write_json(output);
+                const std::string json = output.str();
+
+                REQUIRE(json.rfind("{\"traceEvents\":[", 0) == 0);
+                REQUIRE(json.find("\"name\":\"outer\",\"ph\":\"X\"") != std::string::npos);
+                REQUIRE(json.find("\"name\":\"other\",\"ph\":\"X\"") != std::string::npos);
+                REQUIRE(json.find("\"args\":{\"name\":\"test \\\"main\\\"\"}") != std::string::npos);
+                REQUIRE(json.find("\"dur\":") != std::string::npos);
+                REQUIRE(json.substr(json.size() - 4) == "\n]}\n");
+            }
+        }
+
+        WHEN("a scope ends after a nested one")
+        {
+            {
+                RT_TRACE_SCOPE("parent");
+                RT_TRACE_SCOPE("child");
+            }
+
+            THEN("the nested scope is recorded first and lies within the other")
+            {
+                std::ostringstream output;
+                rt_math::trace::write_json(output);
+                const std::string json = output.str();
+
+                REQUIRE(json.find("\"child\"") < json.find("\"parent\""));
+            }
+        }
+    }
+}
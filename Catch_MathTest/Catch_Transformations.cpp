@@ -1,6 +1,9 @@
 #include <catch2/catch.hpp>
 #include <numbers>
+#include <stdexcept>
 #include "../Math/Math.h"
+#include "../Math/Affine.h"
+#include "../Math/Transform.h"
 
 using namespace rt_math;
 
@@ -297,3 +300,138 @@ SCENARIO("Chained transformations must be applied in reverse order", "[all_trans
         REQUIRE(T * p == point(15.0f, 0, 7.0f));
     }
 }
+
+SCENARIO("A transform caches its inverse and normal matrix", "[transform]")
+{
+    GIVEN("t <- transform(scaling(1, 0.5, 1) * rotation_z(pi/5))")
+    {
+        const Matrix<4> m = scaling(1, 0.5f, 1) * rotation_z(std::numbers::pi_v<float> / 5);
+        const Transform t = m;
+
+        REQUIRE(t.matrix() == m);
+        REQUIRE(t.inverse() == m.inverse());
+        REQUIRE(t.normal_matrix() == transpose(m.inverse()));
+    }
+}
+
+SCENARIO("Composed transforms compose their inverses", "[transform]")
+{
+    GIVEN("C, B, A as transforms")
+    {
+        const Transform A = rotation_x(std::numbers::pi_v<float> / 2);
+        const Transform B = scaling(5.0f, 5.0f, 5.0f);
+        const Transform C = translation(10.0f, 5.0f, 7.0f);
+
+        const Transform T = C * B * A;
+        const Matrix<4> expected = translation(10.0f, 5.0f, 7.0f) * scaling(5.0f, 5.0f, 5.0f) * rotation_x(std::numbers::pi_v<float> / 2);
+
+        REQUIRE(T * point(1.0f, 0, 1.0f) == point(15.0f, 0, 7.0f));
+        REQUIRE(T.inverse() == expected.inverse());
+        REQUIRE(T.normal_matrix() == transpose(expected.inverse()));
+    }
+}
+
+SCENARIO("Transforming a normal keeps it a unit vector", "[transform]")
+{
+    GIVEN("t <- translation(0, 1, 0)")
+    {
+        const Transform t = translation(0, 1, 0);
+
+        REQUIRE(t.normal_to_world(vector(0, 0.70711f, -0.70711f)) == vector(0, 0.70711f, -0.70711f));
+    }
+}
+
+SCENARIO("Transformation chains fold at compile time", "[all_transformations]")
+{
+    GIVEN("a clock hand built as a constant expression")
+    {
+        constexpr Matrix<4> transform =
+            translation(450, 250, 0) *
+            rotation_z(std::numbers::pi_v<float> / 2) *
+            scaling(1, 150, 1);
+        constexpr tuple hand = transform * point(0, 1, 0);
+
+        STATIC_REQUIRE(hand == point(300, 250, 0));
+        STATIC_REQUIRE(transpose(transpose(transform)) == transform);
+        STATIC_REQUIRE(transform.inverse() * hand == point(0, 1, 0));
+    }
+
+    GIVEN("angles beyond a full turn")
+    {
+        constexpr float angle = 7.5f;
+
+        THEN("the compile time sin and cos match the run time ones")
+        {
+            STATIC_REQUIRE(eq_f(constexpr_sin(std::numbers::pi_v<float> / 6), 0.5f));
+
+            constexpr float sin = constexpr_sin(angle);
+            constexpr float cos = constexpr_cos(-angle);
+            REQUIRE(eq_f(sin, std::sin(angle)));
+            REQUIRE(eq_f(cos, std::cos(-angle)));
+
+            constexpr Matrix<4> rotation = rotation_x(angle);
+            REQUIRE(rotation == Matrix<4>{
+                1, 0,               0,                0,
+                0, std::cos(angle), -std::sin(angle), 0,
+                0, std::sin(angle), std::cos(angle),  0,
+                0, 0,               0,                1
+            });
+        }
+    }
+}
+
+SCENARIO("Affine matrices store and apply only the top three rows", "[affine]")
+{
+    GIVEN("a chain of builders as a Matrix<4> and as an Affine")
+    {
+        const Matrix<4> m = translation(10, 5, 7) * rotation_y(0.4f) * shearing(1, 0, 0, 0, 0, 1) * scaling(2, 3, 4);
+        const Affine a = Affine(m);
+
+        THEN("both agree on every entry, tuple and inverse")
+        {
+            REQUIRE(a == m);
+            REQUIRE(static_cast<Matrix<4>>(a) == m);
+            REQUIRE(a.at(3, 0) == 0.0f);
+            REQUIRE(a.at(3, 3) == 1.0f);
+            REQUIRE(a * point(1, -2, 3) == m * point(1, -2, 3));
+            REQUIRE(a * vector(1, -2, 3) == m * vector(1, -2, 3));
+            REQUIRE(a.inverse() == m.inverse());
+            REQUIRE(a * a.inverse() == Affine());
+        }
+
+        THEN("products match the 4x4 product")
+        {
+            const Matrix<4> other = rotation_x(1.1f) * translation(-1, 2, 0.5f);
+            REQUIRE(a * Affine(other) == m * other);
+        }
+    }
+
+    GIVEN("a transform")
+    {
+        const Transform t = translation(1, 2, 3) * scaling(2, 2, 2);
+
+        THEN("it holds two affine matrices, a quarter less than two Matrix<4>")
+        {
+            STATIC_REQUIRE(sizeof(Affine) * 4 == sizeof(Matrix<4>) * 3);
+            STATIC_REQUIRE(sizeof(Transform) == 2 * sizeof(Affine));
+            REQUIRE(t * point(1, 1, 1) == point(3, 4, 5));
+        }
+    }
+
+    GIVEN("a projective matrix, whose bottom row is not 0 0 0 1")
+    {
+        const Matrix<4> projective = Matrix<4> {
+            1, 0, 0, 0,
+            0, 1, 0, 0,
+            0, 0, 1, 0,
+            0, 0, 1, 0
+        };
+
+        THEN("neither an Affine nor a Transform can be made from it")
+        {
+            REQUIRE_THROWS_AS(Affine(projective), std::invalid_argument);
+            REQUIRE_THROWS_AS(Transform(projective), std::invalid_argument);
+            REQUIRE_THROWS_AS(Transform(projective * translation(1, 0, 0)), std::invalid_argument);
+        }
+    }
+}
@@ -0,0 +1,141 @@
+#pragma warning(push, 0)
+#include <catch2/catch.hpp>
+#pragma warning(pop)
+
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../Benchmarks/BenchmarkSuite.h"
+
+SCENARIO("Benchmark results survive a round trip through JSON", "[benchmarks]")
+{
+	GIVEN("a suite that measured two benchmarks, one with a quote in its name")
+	{
+		BenchmarkSuite suite("", 3);
+		suite.measure("math/plain", 10, [](const size_t i) { return static_cast<float>(i); });
+		suite.measure("math/\"quoted\" \\ name", 20, [](const size_t i) { return static_cast<float>(i) * 0.5f; });
+
+		WHEN("they are written and read back")
+		{
+			std::stringstream json;
+			suite.write_json(json);
+			const std::optional<std::vector<BenchmarkResult>> read = read_json(json);
+
+			THEN("every name, time and iteration count is what was measured")
+			{
+				REQUIRE(read.has_value());
+				REQUIRE(read->size() == 2);
+				for (size_t i = 0; i < 2; ++i)
+				{
+					REQUIRE((*read)[i].name == suite.results()[i].name);
+					REQUIRE((*read)[i].ns_per_op == suite.results()[i].ns_per_op);
+					REQUIRE((*read)[i].iterations == suite.results()[i].iterations);
+				}
+			}
+		}
+
+		WHEN("the JSON is cut short")
+		{
+			std::stringstream json;
+			suite.write_json(json);
+			const std::string text = json.str();
+			std::istringstream truncated(text.substr(0, text.size() - 4));
+
+			THEN("nothing is read")
+			{
+				REQUIRE_FALSE(read_json(truncated).has_value());
+			}
+		}
+	}
+
+	GIVEN("input that is not benchmark results")
+	{
+		std::istringstream other("{ \"results\": [] }");
+		std::istringstream empty("");
+
+		THEN("nothing is read")
+		{
+			REQUIRE_FALSE(read_json(other).has_value());
+			REQUIRE_FALSE(read_json(empty).has_value());
+		}
+	}
+}
+
+SCENARIO("Comparing two benchmark runs", "[benchmarks]")
+{
+	GIVEN("a baseline of three benchmarks")
+	{
+		const std::vector<BenchmarkResult> baseline = {
+			{ "a", 100.0, 10 },
+			{ "b", 200.0, 10 },
+			{ "c", 50.0, 10 },
+		};
+		std::ostringstream output;
+
+		WHEN("the current run is within the threshold everywhere")
+		{
+			const std::vector<BenchmarkResult> current = {
+				{ "a", 105.0, 10 },
+				{ "b", 150.0, 10 },
+				{ "c", 50.0, 10 },
+			};
+			const Comparison comparison = compare(baseline, current, 10.0, output);
+
+			THEN("all three are compared and none regressed")
+			{
+				REQUIRE(comparison.compared == 3);
+				REQUIRE(comparison.regressions == 0);
+				REQUIRE(output.str().find("REGRESSION") == std::string::npos);
+			}
+		}
+
+		WHEN("one benchmark got slower than the threshold")
+		{
+			const std::vector<BenchmarkResult> current = {
+				{ "a", 100.0, 10 },
+				{ "b", 230.0, 10 },
+				{ "c", 50.0, 10 },
+			};
+			const Comparison comparison = compare(baseline, current, 10.0, output);
+
+			THEN("it is the one regression, and is reported as such")
+			{
+				REQUIRE(comparison.compared == 3);
+				REQUIRE(comparison.regressions == 1);
+				REQUIRE(output.str().find("REGRESSION") != std::string::npos);
+			}
+		}
+
+		WHEN("the current run lacks one benchmark and has a new one")
+		{
+			const std::vector<BenchmarkResult> current = {
+				{ "a", 300.0, 10 },
+				{ "c", 50.0, 10 },
+				{ "d", 10.0, 10 },
+			};
+			const Comparison comparison = compare(baseline, current, 10.0, output);
+
+			THEN("only the shared ones are compared, the others are listed")
+			{
+				REQUIRE(comparison.compared == 2);
+				REQUIRE(comparison.regressions == 1);
+				// names are padded to 44 columns
+				REQUIRE(output.str().find("b" + std::string(43, ' ') + "  missing") != std::string::npos);
+				REQUIRE(output.str().find("d" + std::string(43, ' ') + "  new") != std::string::npos);
+			}
+		}
+
+		WHEN("no benchmark is in both runs")
+		{
+			const std::vector<BenchmarkResult> current = { { "d", 10.0, 10 } };
+			const Comparison comparison = compare(baseline, current, 10.0, output);
+
+			THEN("nothing is compared")
+			{
+				REQUIRE(comparison.compared == 0);
+				REQUIRE(comparison.regressions == 0);
+			}
+		}
+	}
+}
@@ -3,6 +3,12 @@
 #include <catch2/catch.hpp>
 #pragma warning(pop)
 
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <utility>
+#include <vector>
 #include "../Renderer/Canvas.h"
 
 SCENARIO("Creating a canvas", "[canvas]")
@@ -44,3 +50,191 @@ SCENARIO("Writing pixels to a canvas", "[canvas]")
 		}
 	}
 }
+
+SCENARIO("A canvas backed by a memory mapped file", "[canvas]")
+{
+	GIVEN("c <- canvas(300, 200) mapped from a file")
+	{
+		Canvas* c = new Canvas(300, 200, "tst_canvas.bin");
+
+		REQUIRE(c->is_mapped());
+		REQUIRE(c->pixel_at(0, 0) == rt_math::color(0, 0, 0));
+		REQUIRE(c->pixel_at(299, 199) == rt_math::color(0, 0, 0));
+
+		WHEN("pixels are written and the canvas is destroyed")
+		{
+			constexpr rt_math::color red = rt_math::color(1, 0, 0);
+			c->write_pixel(2, 3, red);
+			c->write_pixel(299, 199, rt_math::color(0, 0.5, 1));
+
+			REQUIRE(c->pixel_at(2, 3) == red);
+			delete c;
+
+			THEN("the file holds the pixels, row major")
+			{
+				std::ifstream input("tst_canvas.bin", std::ios::binary);
+				std::vector<rt_math::color> pixels(300 * 200);
+				input.read(reinterpret_cast<char*>(pixels.data()), static_cast<std::streamsize>(pixels.size() * sizeof(rt_math::color)));
+
+				REQUIRE(input.gcount() == static_cast<std::streamsize>(pixels.size() * sizeof(rt_math::color)));
+				REQUIRE(pixels[3 * 300 + 2] == red);
+				REQUIRE(pixels[199 * 300 + 299] == rt_math::color(0, 0.5, 1));
+				REQUIRE(pixels[0] == rt_math::color(0, 0, 0));
+			}
+		}
+	}
+}
+
+SCENARIO("A tiled canvas keeps the pixel interface", "[canvas]")
+{
+	GIVEN("c <- tiled canvas(21, 13), not a multiple of the tile size")
+	{
+		Canvas* c = new Canvas(21, 13, CanvasLayout::Tiled);
+
+		REQUIRE(c->layout() == CanvasLayout::Tiled);
+		REQUIRE(c->pixel_at(20, 12) == rt_math::color(0, 0, 0));
+
+		WHEN("every pixel is written from its coordinates")
+		{
+			for (unsigned int y = 0; y < 13; ++y)
+			{
+				for (unsigned int x = 0; x < 21; ++x)
+				{
+					c->write_pixel(x, y, rt_math::color(static_cast<float>(x), static_cast<float>(y), 0));
+				}
+			}
+
+			THEN("every pixel reads back")
+			{
+				for (unsigned int y = 0; y < 13; ++y)
+				{
+					for (unsigned int x = 0; x < 21; ++x)
+					{
+						REQUIRE(c->pixel_at(x, y) == rt_math::color(static_cast<float>(x), static_cast<float>(y), 0));
+					}
+				}
+			}
+
+			THEN("for_each_pixel visits each pixel once, 2x2 blocks first")
+			{
+				std::vector<int> visits(21 * 13, 0);
+				std::vector<std::pair<unsigned int, unsigned int>> order;
+				c->for_each_pixel([&](const unsigned int x, const unsigned int y, const rt_math::color& pixel)
+				{
+					REQUIRE(pixel == rt_math::color(static_cast<float>(x), static_cast<float>(y), 0));
+					++visits[y * 21 + x];
+					order.emplace_back(x, y);
+				});
+
+				REQUIRE(std::count(visits.begin(), visits.end(), 1) == 21 * 13);
+				REQUIRE(order[0] == std::make_pair(0u, 0u));
+				REQUIRE(order[1] == std::make_pair(1u, 0u));
+				REQUIRE(order[2] == std::make_pair(0u, 1u));
+				REQUIRE(order[3] == std::make_pair(1u, 1u));
+				REQUIRE(order[4] == std::make_pair(2u, 0u));
+			}
+
+			THEN("read_rows gathers row major rows from the middle of a tile")
+			{
+				std::vector<rt_math::color> scratch;
+				const rt_math::color* rows = c->read_rows(5, 6, scratch);
+				for (unsigned int y = 0; y < 6; ++y)
+				{
+					for (unsigned int x = 0; x < 21; ++x)
+					{
+						REQUIRE(rows[y * 21 + x] == rt_math::color(static_cast<float>(x), static_cast<float>(y + 5), 0));
+					}
+				}
+			}
+		}
+
+		WHEN("for_each_pixel updates pixels in place")
+		{
+			c->for_each_pixel([](const unsigned int x, const unsigned int y, rt_math::color& pixel)
+			{
+				pixel = rt_math::color(static_cast<float>(x + y), 0, 0);
+			});
+
+			THEN("pixel_at sees the update")
+			{
+				REQUIRE(c->pixel_at(20, 12) == rt_math::color(32, 0, 0));
+				REQUIRE(c->pixel_at(7, 8) == rt_math::color(15, 0, 0));
+			}
+		}
+
+		delete c;
+	}
+}
+
+SCENARIO("Compact pixel formats", "[canvas]")
+{
+	GIVEN("half float and RGBA8 canvases(64, 32)")
+	{
+		Canvas* full = new Canvas(64, 32);
+		Canvas* half = new Canvas(64, 32, CanvasLayout::RowMajor, PixelFormat::Half);
+		Canvas* rgba8 = new Canvas(64, 32, CanvasLayout::Tiled, PixelFormat::Rgba8);
+
+		THEN("they take 6 and 4 bytes per pixel instead of 16")
+		{
+			REQUIRE(full->storage_bytes() == 64 * 32 * 16);
+			REQUIRE(half->storage_bytes() == 64 * 32 * 6);
+			REQUIRE(rgba8->storage_bytes() == 64 * 32 * 4);
+			REQUIRE(half->pixel_at(63, 31) == rt_math::color(0, 0, 0));
+			REQUIRE(rgba8->pixel_at(63, 31) == rt_math::color(0, 0, 0));
+		}
+
+		WHEN("colors are written")
+		{
+			half->write_pixel(1, 2, rt_math::color(0.25f, 1.0f / 3.0f, 1000.5f));
+			rgba8->write_pixel(1, 2, rt_math::color(1.5f, 0.5f, -0.25f));
+
+			THEN("half keeps 11 significant bits and values above 1")
+			{
+				const rt_math::color pixel = half->pixel_at(1, 2);
+				REQUIRE(pixel.red == 0.25f);
+				REQUIRE(std::abs(pixel.green - 1.0f / 3.0f) < 1.0f / 2048);
+				REQUIRE(pixel.blue == 1000.5f);
+			}
+
+			THEN("RGBA8 clamps and quantizes to 1/255 steps")
+			{
+				REQUIRE(rgba8->pixel_at(1, 2) == rt_math::color(1, 128 / 255.0f, 0));
+			}
+		}
+
+		WHEN("pixels are updated in place through for_each_pixel")
+		{
+			half->for_each_pixel([](const unsigned int x, unsigned int, rt_math::color& pixel)
+			{
+				pixel = rt_math::color(static_cast<float>(x), 0, 0);
+			});
+
+			THEN("the update is stored")
+			{
+				REQUIRE(half->pixel_at(63, 0) == rt_math::color(63, 0, 0));
+			}
+		}
+
+		delete rgba8;
+		delete half;
+		delete full;
+	}
+}
+
+SCENARIO("Converting between single and half precision", "[canvas]")
+{
+	GIVEN("values at the edges of the half float range")
+	{
+		THEN("they round trip or round to nearest even")
+		{
+			REQUIRE(pixel_format::half_to_float(pixel_format::float_to_half(65504.0f)) == 65504.0f);
+			REQUIRE(std::isinf(pixel_format::half_to_float(pixel_format::float_to_half(70000.0f))));
+			REQUIRE(pixel_format::half_to_float(pixel_format::float_to_half(-2.0f)) == -2.0f);
+			// smallest subnormal half
+			REQUIRE(pixel_format::half_to_float(pixel_format::float_to_half(5.9604645e-8f)) == 5.9604645e-8f);
+			// 1 + 2^-11 is exactly between 1 and the next half, ties to even
+			REQUIRE(pixel_format::half_to_float(pixel_format::float_to_half(1.00048828125f)) == 1.0f);
+			REQUIRE(std::isnan(pixel_format::half_to_float(pixel_format::float_to_half(std::numeric_limits<float>::quiet_NaN()))));
+		}
+	}
+}
@@ -6,6 +6,8 @@
 #include <sstream>
 #include "../Renderer/Canvas.h"
 #include "../Renderer/PpmWriter.h"
+#include "../Renderer/PpmStreamWriter.h"
+#include "../Renderer/TileRenderer.h"
 #include "../Math/Math.h"
 
 using namespace rt_math;
@@ -162,3 +164,224 @@ SCENARIO("PPM files are terminated by a newline character", "[ppm]")
 		}
 	}
 }
+
+SCENARIO("Writing a binary P6 file", "[ppm]")
+{
+	GIVEN("c <- canvas(5, 3) with three pixels set")
+	{
+		Canvas* c = new Canvas(5, 3);
+		c->write_pixel(0, 0, color(1.5, 0, 0));
+		c->write_pixel(2, 1, color(0, 0.5, 0));
+		c->write_pixel(4, 2, color(-0.5, 0, 1));
+
+		WHEN("ppm <- canvas_to_ppm(c) in P6 format")
+		{
+			const PpmWriter* writer = new PpmWriter(tmpFileName, PpmFormat::P6);
+			writer->canvas_to_ppm(c);
+
+			std::ifstream input(tmpFileName, std::ios::binary);
+			const std::string contents((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+			const std::string header = "P6\n5 3\n255\n";
+
+			THEN("header is text, followed by 3 bytes per pixel")
+			{
+				REQUIRE(contents.size() == header.size() + 5 * 3 * 3);
+				REQUIRE(contents.substr(0, header.size()) == header);
+
+				const auto byte_at = [&](const unsigned int x, const unsigned int y, const unsigned int channel)
+				{
+					return static_cast<unsigned char>(contents[header.size() + (y * 5 + x) * 3 + channel]);
+				};
+				REQUIRE(byte_at(0, 0, 0) == 255);
+				REQUIRE(byte_at(2, 1, 1) == 128);
+				REQUIRE(byte_at(4, 2, 0) == 0);
+				REQUIRE(byte_at(4, 2, 2) == 255);
+				REQUIRE(byte_at(1, 0, 0) == 0);
+			}
+
+			delete writer;
+		}
+
+		delete c;
+	}
+}
+
+std::string read_file(const std::string& fileName)
+{
+	std::ifstream input(fileName, std::ios::binary);
+	return std::string((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+}
+
+SCENARIO("Streaming rows gives the same file as writing the whole canvas", "[ppm]")
+{
+	GIVEN("c <- canvas(23, 11) with a gradient")
+	{
+		Canvas* c = new Canvas(23, 11);
+		const auto shader = [](const float x, const float y) { return color(x / 23.0f, y / 11.0f, 0.5f); };
+		for (unsigned int y = 0; y < c->height; ++y)
+		{
+			for (unsigned int x = 0; x < c->width; ++x)
+			{
+				c->write_pixel(x, y, shader(x + 0.5f, y + 0.5f));
+			}
+		}
+
+		// what PpmWriter produces for the whole canvas
+		const auto expected = [c](const PpmFormat format)
+		{
+			const PpmWriter* writer = new PpmWriter(tmpFileName, format);
+			writer->canvas_to_ppm(c);
+			delete writer;
+			return read_file(tmpFileName);
+		};
+
+		WHEN("the rows are written one at a time")
+		{
+			THEN("the stream is complete and matches, in both formats")
+			{
+				for (const PpmFormat format : { PpmFormat::P3, PpmFormat::P6 })
+				{
+					PpmStreamWriter* stream = new PpmStreamWriter("tst_stream.ppm", c->width, c->height, format);
+					std::vector<rt_math::color> scratch;
+					for (unsigned int y = 0; y < c->height; ++y)
+					{
+						stream->write_row(c->read_rows(y, 1, scratch));
+					}
+
+					REQUIRE(stream->complete());
+					delete stream;
+					REQUIRE(read_file("tst_stream.ppm") == expected(format));
+				}
+			}
+		}
+
+		WHEN("bands of 4 rows are rendered and streamed while the next band renders")
+		{
+			TileRenderer renderer(3, 8);
+
+			THEN("the last band is short, and the file matches in both formats")
+			{
+				for (const PpmFormat format : { PpmFormat::P3, PpmFormat::P6 })
+				{
+					PpmStreamWriter* stream = new PpmStreamWriter("tst_stream.ppm", c->width, c->height, format);
+					unsigned int bands = 0;
+					renderer.render_bands(c->width, c->height, 4, shader, [&](const Canvas& band, const unsigned int rows)
+					{
+						stream->write_rows(band, rows);
+						++bands;
+					});
+
+					REQUIRE(bands == 3);
+					REQUIRE(stream->complete());
+					delete stream;
+					REQUIRE(read_file("tst_stream.ppm") == expected(format));
+				}
+			}
+		}
+
+		delete c;
+	}
+}
+
+SCENARIO("Writing a memory mapped canvas", "[ppm]")
+{
+	GIVEN("the same gradient in an in memory and in a mapped canvas, taller than one write")
+	{
+		Canvas* in_memory = new Canvas(600, 700);
+		Canvas* mapped = new Canvas(600, 700, "tst_canvas.bin");
+		for (unsigned int y = 0; y < 700; ++y)
+		{
+			for (unsigned int x = 0; x < 600; ++x)
+			{
+				const color pixel(x / 600.0f, y / 700.0f, 0.25f);
+				in_memory->write_pixel(x, y, pixel);
+				mapped->write_pixel(x, y, pixel);
+			}
+		}
+
+		THEN("both give the same P6 file")
+		{
+			const PpmWriter* writer = new PpmWriter(tmpFileName, PpmFormat::P6);
+			writer->canvas_to_ppm(in_memory);
+			const std::string expected = read_file(tmpFileName);
+			writer->canvas_to_ppm(mapped);
+			delete writer;
+
+			REQUIRE(expected.size() == std::string("P6\n600 700\n255\n").size() + 600 * 700 * 3);
+			REQUIRE(read_file(tmpFileName) == expected);
+		}
+
+		delete mapped;
+		delete in_memory;
+	}
+}
+
+SCENARIO("Writing a tiled canvas", "[ppm]")
+{
+	GIVEN("the same gradient in a row major and a tiled canvas, taller than one write")
+	{
+		Canvas* row_major = new Canvas(605, 707);
+		Canvas* tiled = new Canvas(605, 707, CanvasLayout::Tiled);
+		for (unsigned int y = 0; y < 707; ++y)
+		{
+			for (unsigned int x = 0; x < 605; ++x)
+			{
+				const color pixel(x / 605.0f, y / 707.0f, 0.75f);
+				row_major->write_pixel(x, y, pixel);
+				tiled->write_pixel(x, y, pixel);
+			}
+		}
+
+		THEN("both give the same P3 and P6 files")
+		{
+			for (const PpmFormat format : { PpmFormat::P3, PpmFormat::P6 })
+			{
+				const PpmWriter* writer = new PpmWriter(tmpFileName, format);
+				writer->canvas_to_ppm(row_major);
+				const std::string expected = read_file(tmpFileName);
+				writer->canvas_to_ppm(tiled);
+				delete writer;
+
+				REQUIRE(read_file(tmpFileName) == expected);
+			}
+		}
+
+		delete tiled;
+		delete row_major;
+	}
+}
+
+SCENARIO("Writing an 8 bit canvas", "[ppm]")
+{
+	GIVEN("the same gradient in a float and in an RGBA8 canvas")
+	{
+		Canvas* full = new Canvas(40, 30);
+		Canvas* compact = new Canvas(40, 30, CanvasLayout::RowMajor, PixelFormat::Rgba8);
+		for (unsigned int y = 0; y < 30; ++y)
+		{
+			for (unsigned int x = 0; x < 40; ++x)
+			{
+				const color pixel(x / 39.0f, y / 29.0f, 1.5f);
+				full->write_pixel(x, y, pixel);
+				compact->write_pixel(x, y, pixel);
+			}
+		}
+
+		THEN("both give the same P3 and P6 files")
+		{
+			for (const PpmFormat format : { PpmFormat::P3, PpmFormat::P6 })
+			{
+				const PpmWriter* writer = new PpmWriter(tmpFileName, format);
+				writer->canvas_to_ppm(full);
+				const std::string expected = read_file(tmpFileName);
+				writer->canvas_to_ppm(compact);
+				delete writer;
+
+				REQUIRE(read_file(tmpFileName) == expected);
+			}
+		}
+
+		delete compact;
+		delete full;
+	}
+}
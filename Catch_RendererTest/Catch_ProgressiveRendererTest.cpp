@@ -0,0 +1,190 @@
+#pragma warning(push, 0)
+#include <catch2/catch.hpp>
+#pragma warning(pop)
+
+#include <cmath>
+#include <fstream>
+#include <string>
+#include "../Renderer/Canvas.h"
+#include "../Renderer/PpmWriter.h"
+#include "../Renderer/ProgressiveRenderer.h"
+#include "../Renderer/TileRenderer.h"
+
+using namespace rt_math;
+
+namespace
+{
+	// same value anywhere inside a pixel, so the mean of any number of samples is exact
+	color pixel_shader(const float x, const float y)
+	{
+		return color(std::floor(x), std::floor(y), 1);
+	}
+}
+
+SCENARIO("Progressive rendering without a deadline", "[progressive]")
+{
+	GIVEN("a 40x25 canvas and 4 samples per pixel")
+	{
+		TileRenderer renderer(3, 16);
+		Canvas* c = new Canvas(40, 25);
+		ProgressiveSettings settings;
+		settings.max_samples = 4;
+		ProgressiveRenderer progressive(renderer, *c, settings);
+
+		WHEN("it renders until the image is final")
+		{
+			const bool finished = progressive.render(pixel_shader, ProgressiveRenderer::Clock::time_point::max());
+
+			THEN("three coarse passes of 8, 4 and 2 pixel blocks ran before the 4 sample passes")
+			{
+				REQUIRE(finished);
+				REQUIRE(progressive.finished());
+				REQUIRE(progressive.samples_per_pixel() == 4);
+				REQUIRE(progressive.passes() == 3 + 4);
+			}
+
+			THEN("every pixel is the mean of its own samples")
+			{
+				for (unsigned int y = 0; y < 25; ++y)
+				{
+					for (unsigned int x = 0; x < 40; ++x)
+					{
+						REQUIRE(c->pixel_at(x, y) == color(static_cast<float>(x), static_cast<float>(y), 1));
+					}
+				}
+			}
+		}
+
+		delete c;
+	}
+}
+
+SCENARIO("Progressive rendering past its deadline", "[progressive]")
+{
+	GIVEN("a 40x25 canvas and a deadline that has already passed")
+	{
+		TileRenderer renderer(2, 16);
+		Canvas* c = new Canvas(40, 25);
+		ProgressiveRenderer progressive(renderer, *c);
+		const auto past = ProgressiveRenderer::Clock::now() - std::chrono::seconds(1);
+
+		WHEN("it renders")
+		{
+			const bool finished = progressive.render(pixel_shader, past);
+
+			THEN("only the first coarse pass ran, and it filled every 8x8 block from its center")
+			{
+				REQUIRE_FALSE(finished);
+				REQUIRE(progressive.passes() == 1);
+				REQUIRE(progressive.samples_per_pixel() == 0);
+				REQUIRE(c->pixel_at(0, 0) == color(4, 4, 1));
+				REQUIRE(c->pixel_at(7, 7) == color(4, 4, 1));
+				REQUIRE(c->pixel_at(8, 0) == color(12, 4, 1));
+				// last block is clipped by the 16 pixel tile, not by the canvas
+				REQUIRE(c->pixel_at(39, 24) == color(36, 24, 1));
+			}
+
+			THEN("the preview can be written out")
+			{
+				const PpmWriter* writer = new PpmWriter("tst_progressive.ppm", PpmFormat::P6);
+				writer->canvas_to_ppm(c);
+				delete writer;
+
+				std::ifstream input("tst_progressive.ppm", std::ios::binary);
+				const std::string contents((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+				REQUIRE(contents.size() == std::string("P6\n40 25\n255\n").size() + 40 * 25 * 3);
+			}
+
+			AND_WHEN("it resumes without a deadline")
+			{
+				REQUIRE(progressive.render(pixel_shader, ProgressiveRenderer::Clock::time_point::max()));
+
+				THEN("it ends with the full image")
+				{
+					REQUIRE(progressive.samples_per_pixel() == ProgressiveSettings().max_samples);
+					REQUIRE(c->pixel_at(39, 24) == color(39, 24, 1));
+				}
+			}
+		}
+
+		delete c;
+	}
+}
+
+SCENARIO("Progressive rendering keeps sums only for unfinished tiles", "[progressive]")
+{
+	GIVEN("a 40x25 half float canvas and 2 samples per pixel")
+	{
+		TileRenderer renderer(2, 16);
+		Canvas* c = new Canvas(40, 25, CanvasLayout::RowMajor, PixelFormat::Half);
+		ProgressiveSettings settings;
+		settings.max_samples = 2;
+		ProgressiveRenderer progressive(renderer, *c, settings);
+		const auto never = ProgressiveRenderer::Clock::time_point::max();
+
+		WHEN("only the coarse passes ran")
+		{
+			for (int pass = 0; pass < 3; ++pass)
+			{
+				progressive.render_pass(pixel_shader, never);
+			}
+
+			THEN("nothing is held for sums")
+			{
+				REQUIRE(progressive.samples_per_pixel() == 0);
+				REQUIRE(progressive.accumulator_bytes() == 0);
+			}
+
+			AND_WHEN("the first refinement pass ran")
+			{
+				progressive.render_pass(pixel_shader, never);
+
+				THEN("every pixel has a full precision sum")
+				{
+					REQUIRE(progressive.samples_per_pixel() == 1);
+					REQUIRE(progressive.accumulator_bytes() == 40 * 25 * sizeof(color));
+				}
+
+				AND_WHEN("the image is final")
+				{
+					REQUIRE(progressive.render(pixel_shader, never));
+
+					THEN("the sums are gone and the canvas holds the means")
+					{
+						REQUIRE(progressive.accumulator_bytes() == 0);
+						REQUIRE(c->pixel_at(0, 0) == color(0, 0, 1));
+						REQUIRE(c->pixel_at(39, 24) == color(39, 24, 1));
+					}
+				}
+			}
+		}
+
+		delete c;
+	}
+}
+
+SCENARIO("Sample positions", "[progressive]")
+{
+	GIVEN("the first 16 sample offsets")
+	{
+		THEN("the first is the pixel center, all lie inside the pixel, spread over its quadrants")
+		{
+			REQUIRE(ProgressiveRenderer::sample_offset(0) == std::make_pair(0.5f, 0.5f));
+
+			int quadrants[4] = {};
+			for (unsigned int i = 0; i < 16; ++i)
+			{
+				const auto [x, y] = ProgressiveRenderer::sample_offset(i);
+				REQUIRE(x >= 0.0f);
+				REQUIRE(x < 1.0f);
+				REQUIRE(y >= 0.0f);
+				REQUIRE(y < 1.0f);
+				++quadrants[(x < 0.5f ? 0 : 1) + (y < 0.5f ? 0 : 2)];
+			}
+			for (const int count : quadrants)
+			{
+				REQUIRE(count >= 3);
+			}
+		}
+	}
+}
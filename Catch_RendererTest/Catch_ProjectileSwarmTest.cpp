@@ -0,0 +1,133 @@
+#pragma warning(push, 0)
+#include <catch2/catch.hpp>
+#pragma warning(pop)
+
+#include <random>
+#include <vector>
+#include "../Ch1_Projectile/swarm.h"
+#include "../Math/Parallel.h"
+
+using namespace rt_math;
+
+namespace
+{
+// bit for bit, tuple's operator== allows an epsilon
+bool same(const tuple& a, const tuple& b)
+{
+	return a.x == b.x && a.y == b.y && a.z == b.z && a.w == b.w;
+}
+}
+
+SCENARIO("A projectile swarm moves like tick() on every projectile", "[projectile]")
+{
+	GIVEN("the chapter 1 environment and enough projectiles for several threads, landing at different ticks")
+	{
+		const Environment environment(vector(0.0f, -0.1f, 0.0f), vector(-0.01f, 0.0f, 0.0f));
+
+		// not a multiple of 4, so the last chunk ends in a partial SIMD step
+		constexpr size_t count = min_elements_per_thread * 2 + 1003;
+		constexpr unsigned int threads = 4;
+		REQUIRE(chunk_threads(count, threads) == 2);
+
+		std::mt19937 random(7);
+		std::uniform_real_distribution<float> coordinate(0.0f, 20.0f);
+		std::uniform_real_distribution<float> speed(-2.0f, 2.0f);
+
+		ProjectileSwarm swarm(environment);
+		std::vector<Projectile> expected;
+		for (size_t i = 0; i < count; ++i)
+		{
+			const Projectile projectile(
+				point(coordinate(random), coordinate(random), coordinate(random)),
+				vector(speed(random), speed(random), speed(random))
+			);
+			swarm.add(projectile);
+			expected.push_back(projectile);
+		}
+
+		WHEN("it ticks on several threads until every projectile has landed")
+		{
+			size_t ticks = 0;
+			size_t mismatched_tick = 0;
+			while (!swarm.empty() && mismatched_tick == 0)
+			{
+				++ticks;
+				std::vector<Projectile> survivors;
+				for (Projectile projectile : expected)
+				{
+					tick(&environment, &projectile);
+					if (projectile.position.y >= 0.0f)
+					{
+						survivors.push_back(projectile);
+					}
+				}
+				expected = survivors;
+
+				const size_t left = swarm.tick(threads);
+				bool matches = left == expected.size() && swarm.size() == expected.size();
+				for (size_t i = 0; matches && i < expected.size(); ++i)
+				{
+					const Projectile actual = swarm.at(i);
+					matches = same(actual.position, expected[i].position) && same(actual.velocity, expected[i].velocity);
+				}
+				if (!matches)
+				{
+					mismatched_tick = ticks;
+				}
+			}
+
+			THEN("after every tick the survivors, their order and their values match tick() exactly")
+			{
+				REQUIRE(mismatched_tick == 0);
+				REQUIRE(expected.empty());
+				REQUIRE(ticks > 10);
+			}
+
+			AND_THEN("ticking the empty swarm leaves it empty")
+			{
+				REQUIRE(swarm.tick(threads) == 0);
+			}
+		}
+	}
+}
+
+SCENARIO("Trails only mark pixels on the canvas", "[projectile]")
+{
+	GIVEN("10x5 trails and projectiles on and around the canvas")
+	{
+		const Environment environment(vector(0, 0, 0), vector(0, 0, 0));
+		ProjectileSwarm swarm(environment);
+		const float positions[][2] = {
+			{ 2.4f, 1.6f },   // column 2, row 5 - 2 = 3
+			{ -1.0f, 2.0f },  // left of the canvas
+			{ 9.5f, 2.0f },   // rounds to column 10, right of it
+			{ 3.0f, 6.0f },   // row -1, above it
+			{ 3.0f, 0.0f },   // row 5, below it
+			{ 1e30f, -1e30f } // far outside both ways
+		};
+		for (const auto& position : positions)
+		{
+			swarm.add(Projectile(point(position[0], position[1], 0), vector(0, 0, 0)));
+		}
+
+		WHEN("they are plotted and written to a canvas")
+		{
+			Trails trails(10, 5);
+			trails.plot(swarm);
+			Canvas canvas(10, 5);
+			trails.write_to(canvas, color(1, 0, 0), color(0, 0, 1));
+
+			THEN("only the projectile on the canvas left a mark")
+			{
+				for (unsigned int y = 0; y < 5; ++y)
+				{
+					for (unsigned int x = 0; x < 10; ++x)
+					{
+						const bool marked = x == 2 && y == 3;
+						REQUIRE(canvas.pixel_at(x, y) == (marked ? color(1, 0, 0) : color(0, 0, 1)));
+					}
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,121 @@
+#pragma warning(push, 0)
+#include <catch2/catch.hpp>
+#pragma warning(pop)
+
+#include <cmath>
+#include <limits>
+#include <vector>
+#include "../Renderer/Quantizer.h"
+
+using namespace rt_math;
+
+SCENARIO("Quantizing colors to 8 bits", "[quantizer]")
+{
+	GIVEN("a quantizer with the default tone mapping")
+	{
+		const Quantizer quantizer;
+
+		WHEN("a ramp through 0..1 is converted")
+		{
+			std::vector<color> pixels;
+			for (int i = 0; i <= 1000; ++i)
+			{
+				const float value = static_cast<float>(i) / 1000.0f;
+				pixels.emplace_back(value, 1.0f - value, value * 0.5f);
+			}
+			std::vector<unsigned char> bytes(pixels.size() * 3);
+			quantizer.to_rgb8(pixels.data(), pixels.size(), bytes.data());
+
+			THEN("every channel is rounded to the nearest step")
+			{
+				for (size_t i = 0; i < pixels.size(); ++i)
+				{
+					REQUIRE(bytes[i * 3] == static_cast<unsigned char>(std::lround(pixels[i].red * 255.0f)));
+					REQUIRE(bytes[i * 3 + 1] == static_cast<unsigned char>(std::lround(pixels[i].green * 255.0f)));
+					REQUIRE(bytes[i * 3 + 2] == static_cast<unsigned char>(std::lround(pixels[i].blue * 255.0f)));
+				}
+			}
+		}
+
+		WHEN("values outside 0..1 are converted")
+		{
+			const color pixels[] = {
+				color(-0.5f, 1.5f, 1000.0f),
+				color(std::numeric_limits<float>::quiet_NaN(), std::numeric_limits<float>::infinity(), 0.5f)
+			};
+			unsigned char bytes[6] = {};
+			quantizer.to_rgb8(pixels, 2, bytes);
+
+			THEN("they are clamped, NaN to black")
+			{
+				REQUIRE(bytes[0] == 0);
+				REQUIRE(bytes[1] == 255);
+				REQUIRE(bytes[2] == 255);
+				REQUIRE(bytes[3] == 0);
+				REQUIRE(bytes[4] == 255);
+				REQUIRE(bytes[5] == 128);
+			}
+		}
+
+		WHEN("counts that are not a multiple of 4 are converted")
+		{
+			THEN("exactly count pixels are written")
+			{
+				for (size_t count = 1; count <= 7; ++count)
+				{
+					const std::vector<color> pixels(count, color(1, 0, 1));
+					std::vector<unsigned char> bytes(count * 3 + 3, 7);
+					quantizer.to_rgb8(pixels.data(), count, bytes.data());
+
+					for (size_t i = 0; i < count; ++i)
+					{
+						REQUIRE(bytes[i * 3] == 255);
+						REQUIRE(bytes[i * 3 + 1] == 0);
+						REQUIRE(bytes[i * 3 + 2] == 255);
+					}
+					REQUIRE(bytes[count * 3] == 7);
+				}
+			}
+		}
+	}
+
+	GIVEN("a Reinhard curve with exposure 2")
+	{
+		ToneMapping mapping;
+		mapping.curve = ToneCurve::Reinhard;
+		mapping.exposure = 2.0f;
+		const Quantizer quantizer(mapping);
+
+		THEN("c * 2 / (1 + c * 2) is what gets quantized")
+		{
+			const color pixel(0.5f, 1.5f, 0);
+			unsigned char bytes[3] = {};
+			quantizer.to_rgb8(&pixel, 1, bytes);
+
+			REQUIRE(bytes[0] == 128);
+			REQUIRE(bytes[1] == 191);
+			REQUIRE(bytes[2] == 0);
+		}
+	}
+
+	GIVEN("a gamma of 2.2")
+	{
+		ToneMapping mapping;
+		mapping.gamma = 2.2f;
+		const Quantizer quantizer(mapping);
+
+		THEN("the table result stays within one step of pow(c, 1 / 2.2)")
+		{
+			for (int i = 0; i <= 100; ++i)
+			{
+				const float value = static_cast<float>(i) / 100.0f;
+				const color pixel(value, value, value);
+				unsigned char bytes[3] = {};
+				quantizer.to_rgb8(&pixel, 1, bytes);
+
+				const float exact = std::pow(value, 1.0f / 2.2f) * 255.0f;
+				REQUIRE(std::abs(static_cast<float>(bytes[0]) - exact) <= 1.0f);
+			}
+		}
+	}
+}
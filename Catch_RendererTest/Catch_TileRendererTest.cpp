@@ -0,0 +1,305 @@
+#pragma warning(push, 0)
+#include <catch2/catch.hpp>
+#pragma warning(pop)
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "../Renderer/Canvas.h"
+#include "../Renderer/PpmStreamWriter.h"
+#include "../Renderer/PpmWriter.h"
+#include "../Renderer/TileRenderer.h"
+#include "../Math/Arena.h"
+#include "../Math/Stats.h"
+
+using namespace rt_math;
+
+SCENARIO("Rendering tiles on several threads fills every pixel once", "[tiles]")
+{
+	GIVEN("c <- canvas(70, 45), not a multiple of the tile size")
+	{
+		Canvas* c = new Canvas(70, 45);
+
+		AND_GIVEN("a renderer with 4 threads and 16 pixel tiles")
+		{
+			TileRenderer renderer(4, 16);
+
+			WHEN("each pixel is shaded from its own coordinates")
+			{
+				std::atomic<unsigned int> calls{ 0 };
+				renderer.render(*c, [&calls](const float x, const float y)
+				{
+					++calls;
+					return color(x / 100.0f, y / 100.0f, 1);
+				});
+
+				THEN("every pixel was shaded exactly once, at its center")
+				{
+					REQUIRE(calls == 70 * 45);
+					for (unsigned int y = 0; y < 45; ++y)
+					{
+						for (unsigned int x = 0; x < 70; ++x)
+						{
+							REQUIRE(c->pixel_at(x, y) == color((x + 0.5f) / 100.0f, (y + 0.5f) / 100.0f, 1));
+						}
+					}
+				}
+			}
+		}
+
+		delete c;
+	}
+}
+
+SCENARIO("A renderer can be reused for several frames", "[tiles]")
+{
+	GIVEN("a renderer with 3 threads")
+	{
+		TileRenderer renderer(3, 8);
+		Canvas* c = new Canvas(33, 17);
+
+		WHEN("it renders 20 frames")
+		{
+			for (int frame = 0; frame < 20; ++frame)
+			{
+				renderer.render(*c, [frame](float, float) { return color(static_cast<float>(frame), 0, 0); });
+			}
+
+			THEN("the canvas holds the last frame")
+			{
+				REQUIRE(c->pixel_at(0, 0) == color(19, 0, 0));
+				REQUIRE(c->pixel_at(32, 16) == color(19, 0, 0));
+			}
+		}
+
+		delete c;
+	}
+}
+
+SCENARIO("A shader that throws stops the frame", "[tiles]")
+{
+	GIVEN("a renderer with 4 threads and 8 pixel tiles")
+	{
+		TileRenderer renderer(4, 8);
+		Canvas* c = new Canvas(64, 64);
+
+		WHEN("the shader throws for one pixel, on whichever thread gets it")
+		{
+			std::atomic<unsigned int> calls{ 0 };
+			const auto throwing = [&calls](const float x, const float y)
+			{
+				++calls;
+				if (x == 40.5f && y == 40.5f)
+				{
+					throw std::runtime_error("shader failed");
+				}
+				return color(1, 1, 1);
+			};
+
+			THEN("render rethrows it after every thread left the frame")
+			{
+				REQUIRE_THROWS_WITH(renderer.render(*c, throwing), "shader failed");
+				const unsigned int calls_at_return = calls;
+				std::this_thread::sleep_for(std::chrono::milliseconds(20));
+				REQUIRE(calls == calls_at_return);
+				REQUIRE(calls_at_return <= 64 * 64);
+			}
+
+			THEN("the renderer still renders the next frame in full")
+			{
+				REQUIRE_THROWS_AS(renderer.render(*c, throwing), std::runtime_error);
+				renderer.render(*c, [](float, float) { return color(0, 1, 0); });
+				for (unsigned int y = 0; y < 64; ++y)
+				{
+					for (unsigned int x = 0; x < 64; ++x)
+					{
+						REQUIRE(c->pixel_at(x, y) == color(0, 1, 0));
+					}
+				}
+			}
+		}
+
+		delete c;
+	}
+}
+
+SCENARIO("Rendering into an 8 bit canvas", "[tiles]")
+{
+	GIVEN("an RGBA8 canvas and a float canvas of the same size")
+	{
+		TileRenderer renderer(2, 16);
+		Canvas* compact = new Canvas(50, 20, CanvasLayout::RowMajor, PixelFormat::Rgba8);
+		Canvas* full = new Canvas(50, 20);
+
+		WHEN("both render the same gradient")
+		{
+			const auto shader = [](const float x, const float y) { return color(x / 50.0f, y / 20.0f, 0.5f); };
+			renderer.render(*compact, shader);
+			renderer.render(*full, shader);
+
+			THEN("the compact canvas holds the float result, quantized once")
+			{
+				for (unsigned int y = 0; y < 20; ++y)
+				{
+					for (unsigned int x = 0; x < 50; ++x)
+					{
+						const color expected = full->pixel_at(x, y);
+						const color pixel = compact->pixel_at(x, y);
+						REQUIRE(pixel_format::float_to_byte(pixel.red) == pixel_format::float_to_byte(expected.red));
+						REQUIRE(pixel_format::float_to_byte(pixel.green) == pixel_format::float_to_byte(expected.green));
+						REQUIRE(pixel_format::float_to_byte(pixel.blue) == pixel_format::float_to_byte(expected.blue));
+					}
+				}
+			}
+		}
+
+		delete full;
+		delete compact;
+	}
+}
+
+SCENARIO("Rendering is counted in the statistics", "[tiles]")
+{
+	GIVEN("cleared statistics and a renderer with 3 threads and 16 pixel tiles")
+	{
+		rt_math::stats::reset();
+		TileRenderer renderer(3, 16);
+		Canvas* c = new Canvas(70, 45);
+
+		WHEN("a frame is rendered and written")
+		{
+			renderer.render(*c, [](float, float) { return color(1, 0, 0); });
+			const PpmWriter* writer = new PpmWriter("tst_stats.ppm", PpmFormat::P6);
+			writer->canvas_to_ppm(c);
+			delete writer;
+
+			THEN("every worker's counts are in once the frame returns")
+			{
+				const rt_math::stats::Counters counters = rt_math::stats::collect();
+				REQUIRE(counters.primary_rays == 70 * 45);
+				REQUIRE(counters.tiles == 5 * 3);
+				REQUIRE(counters.bytes_written == std::string("P6\n70 45\n255\n").size() + 70 * 45 * 3);
+			}
+		}
+
+		WHEN("a frame is streamed in bands")
+		{
+			PpmStreamWriter* writer = new PpmStreamWriter("tst_stats_stream.ppm", 70, 45, PpmFormat::P6);
+			renderer.render_bands(70, 45, 16, [](float, float) { return color(1, 0, 0); }, [writer](const Canvas& band, const unsigned int rows)
+			{
+				writer->write_rows(band, rows);
+			});
+			delete writer;
+
+			THEN("the bytes the sink threads wrote are in as well")
+			{
+				const rt_math::stats::Counters counters = rt_math::stats::collect();
+				REQUIRE(counters.primary_rays == 70 * 45);
+				REQUIRE(counters.bytes_written == std::string("P6\n70 45\n255\n").size() + 70 * 45 * 3);
+			}
+		}
+
+		delete c;
+	}
+}
+
+SCENARIO("Bands are streamed to one sink thread", "[tiles]")
+{
+	GIVEN("a renderer with 3 threads and 8 pixel tiles")
+	{
+		TileRenderer renderer(3, 8);
+
+		WHEN("a 20x45 image is rendered in bands of 0 rows")
+		{
+			std::vector<unsigned int> band_rows;
+			std::vector<std::thread::id> sink_threads;
+			std::vector<color> first_pixels;
+			renderer.render_bands(20, 45, 0, [](float, float y) { return color(y, 0, 0); }, [&](const Canvas& band, const unsigned int rows)
+			{
+				band_rows.push_back(rows);
+				sink_threads.push_back(std::this_thread::get_id());
+				first_pixels.push_back(band.pixel_at(0, 0));
+			});
+
+			THEN("it is rendered one row per band, and every band went through the same thread")
+			{
+				REQUIRE(band_rows == std::vector<unsigned int>(45, 1));
+				for (size_t i = 0; i < first_pixels.size(); ++i)
+				{
+					REQUIRE(first_pixels[i] == color(i + 0.5f, 0, 0));
+				}
+				REQUIRE(sink_threads.front() != std::this_thread::get_id());
+				REQUIRE(std::count(sink_threads.begin(), sink_threads.end(), sink_threads.front()) == 45);
+			}
+		}
+
+		WHEN("the sink throws on the second band")
+		{
+			unsigned int bands = 0;
+			const auto stream = [&]()
+			{
+				renderer.render_bands(20, 45, 10, [](float, float) { return color(1, 0, 0); }, [&bands](const Canvas&, unsigned int)
+				{
+					if (++bands == 2)
+					{
+						throw std::runtime_error("disk full");
+					}
+				});
+			};
+
+			THEN("the exception reaches the caller and no later band is sunk")
+			{
+				REQUIRE_THROWS_WITH(stream(), "disk full");
+				REQUIRE(bands == 2);
+			}
+		}
+	}
+}
+
+SCENARIO("Shader scratch memory is reset after every tile", "[tiles]")
+{
+	GIVEN("a single threaded renderer with 32 pixel tiles and a 128x128 canvas")
+	{
+		TileRenderer renderer(1, 32);
+		Canvas* c = new Canvas(128, 128);
+
+		WHEN("every pixel takes 1 KiB from the thread's arena")
+		{
+			renderer.render(*c, [](const float x, const float y)
+			{
+				float* scratch = thread_arena().allocate<float>(256);
+				scratch[255] = x + y;
+				return color(scratch[255], 0, 0);
+			});
+
+			THEN("the arena holds about one tile's worth, not the frame's")
+			{
+				REQUIRE(c->pixel_at(3, 4) == color(8, 0, 0));
+				REQUIRE(thread_arena().capacity() < 2 * 32 * 32 * 1024);
+			}
+		}
+
+		WHEN("the calling thread holds arena memory of its own while it renders")
+		{
+			int* kept = thread_arena().allocate<int>(16);
+			std::fill(kept, kept + 16, 42);
+			renderer.render(*c, [](float, float)
+			{
+				unsigned char* scratch = thread_arena().allocate<unsigned char>(1024);
+				std::fill(scratch, scratch + 1024, static_cast<unsigned char>(0xFF));
+				return color(0, 0, 0);
+			});
+
+			THEN("that memory is left alone")
+			{
+				REQUIRE(std::count(kept, kept + 16, 42) == 16);
+			}
+			thread_arena().reset();
+		}
+
+		delete c;
+	}
+}
@@ -1,50 +1,71 @@
-﻿#include <iostream>
-#include "simulator.h"
+﻿#include <algorithm>
+#include <charconv>
+#include <iostream>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include "swarm.h"
 
 #include "../Renderer/Canvas.h"
 #include "../Renderer/PpmWriter.h"
 
-int main()
+/*
+ * Ch1_Projectile [count]
+ * count projectiles (default 1) launched at angles fanning upwards from the first one's.
+ * Exits with 2 if count is not a whole number of at least 1.
+ */
+int main(int argc, char* argv[])
 {
+	size_t count = 1;
+	if (argc > 1)
+	{
+		const std::string_view text(argv[1]);
+		const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), count);
+		if (argc > 2 || error != std::errc() || end != text.data() + text.size() || count == 0)
+		{
+			std::cerr << "usage: Ch1_Projectile [count], count a whole number of projectiles, at least 1" << std::endl;
+			return 2;
+		}
+	}
 
 	const rt_math::tuple startingPoint = rt_math::point(0, 1, 0);
-	const rt_math::tuple startingVelocity = normalize(rt_math::vector(1, 1.8f, 0)) * 11.25f;
 
-	Projectile *projectile = new Projectile(
-        startingPoint,
-        startingVelocity
-    );
-
-	const Environment* environment = new Environment(
+	const Environment environment(
         rt_math::vector(0.0f, -0.1f, 0.0f),
         rt_math::vector(-0.01f, 0.0f, 0.0f)
     );
 
+	ProjectileSwarm swarm(environment);
+	swarm.reserve(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		const float steepness = 1.8f + static_cast<float>(i) / static_cast<float>(count);
+		swarm.add(Projectile(
+			startingPoint,
+			normalize(rt_math::vector(1, steepness, 0)) * 11.25f
+		));
+	}
+
     constexpr int width = 900;
     constexpr int height = 500;
     Canvas* canvas = new Canvas(width, height);
-    
+    Trails trails(width, height);
 
-    while(projectile->position.y >= 0.0f)
+	const unsigned int threads = std::max(std::thread::hardware_concurrency(), 1u);
+    while(!swarm.empty())
     {
 
 #ifdef VERBOSE
       std::cout
-    		<< "x: " << projectile->position.x
-    		<< " y: " << projectile->position.y << std::endl;
+    		<< "x: " << swarm.x()[0]
+    		<< " y: " << swarm.y()[0] << std::endl;
 #endif
 
-        canvas->write_pixel(
-            static_cast<unsigned int>(std::round(projectile->position.x)),
-            height - static_cast<unsigned int>(std::round(projectile->position.y)),
-            rt_math::color(1, 0, 0)
-        );
-
-        tick(environment, projectile);
+        trails.plot(swarm);
+        swarm.tick(threads);
     }
 
-    delete environment;
-    delete projectile;
+    trails.write_to(*canvas, rt_math::color(1, 0, 0));
 
     const PpmWriter* writer = new PpmWriter("projectile.ppm");
     writer->canvas_to_ppm(canvas);
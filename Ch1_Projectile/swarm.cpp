@@ -0,0 +1,186 @@
+#include "swarm.h"
+#include <array>
+#include <cmath>
+#include <cstring>
+#include "../Math/Parallel.h"
+#include "../Math/Simd.h"
+
+using namespace rt_math;
+
+ProjectileSwarm::ProjectileSwarm(const Environment& environment)
+	: gravity_(environment.gravity), wind_(environment.wind) {}
+
+void ProjectileSwarm::reserve(const size_t count)
+{
+	for (std::vector<float>* component : { &this->x_, &this->y_, &this->z_, &this->vx_, &this->vy_, &this->vz_ })
+	{
+		component->reserve(count);
+	}
+}
+
+void ProjectileSwarm::add(const Projectile& projectile)
+{
+	this->x_.push_back(projectile.position.x);
+	this->y_.push_back(projectile.position.y);
+	this->z_.push_back(projectile.position.z);
+	this->vx_.push_back(projectile.velocity.x);
+	this->vy_.push_back(projectile.velocity.y);
+	this->vz_.push_back(projectile.velocity.z);
+}
+
+Projectile ProjectileSwarm::at(const size_t index) const
+{
+	return Projectile(
+		point(this->x_[index], this->y_[index], this->z_[index]),
+		vector(this->vx_[index], this->vy_[index], this->vz_[index])
+	);
+}
+
+size_t ProjectileSwarm::tick(const unsigned int thread_count)
+{
+	const size_t count = this->size();
+	if (count == 0)
+	{
+		return 0;
+	}
+
+	const unsigned int chunks = chunk_threads(count, thread_count);
+	const size_t chunk = chunk_size(count, thread_count);
+
+	// chunks compact in place, each into its own front
+	std::array<size_t, max_chunk_threads> survivors = {};
+	for_each_chunk(count, thread_count, [this, chunk, &survivors](const size_t begin, const size_t end)
+	{
+		survivors[begin / chunk] = this->step(begin, end);
+	});
+
+	// then the gaps between the chunks are closed
+	size_t kept = survivors[0];
+	for (unsigned int i = 1; i < chunks; ++i)
+	{
+		for (std::vector<float>* component : { &this->x_, &this->y_, &this->z_, &this->vx_, &this->vy_, &this->vz_ })
+		{
+			std::memmove(component->data() + kept, component->data() + i * chunk, survivors[i] * sizeof(float));
+		}
+		kept += survivors[i];
+	}
+
+	this->resize(kept);
+	return kept;
+}
+
+size_t ProjectileSwarm::step(const size_t begin, const size_t end)
+{
+	float* const x = this->x_.data();
+	float* const y = this->y_.data();
+	float* const z = this->z_.data();
+	float* const vx = this->vx_.data();
+	float* const vy = this->vy_.data();
+	float* const vz = this->vz_.data();
+
+	const simd::float4 gx = simd::set1(this->gravity_.x), gy = simd::set1(this->gravity_.y), gz = simd::set1(this->gravity_.z);
+	const simd::float4 wx = simd::set1(this->wind_.x), wy = simd::set1(this->wind_.y), wz = simd::set1(this->wind_.z);
+	const simd::float4 ground = simd::zero();
+
+	// survivors are written at kept, which never passes i, so reads stay ahead of writes
+	size_t kept = begin;
+	size_t i = begin;
+	for (; i + 4 <= end; i += 4)
+	{
+		const simd::float4 old_vx = simd::loadu(vx + i), old_vy = simd::loadu(vy + i), old_vz = simd::loadu(vz + i);
+		const simd::float4 new_x = simd::add(simd::loadu(x + i), old_vx);
+		const simd::float4 new_y = simd::add(simd::loadu(y + i), old_vy);
+		const simd::float4 new_z = simd::add(simd::loadu(z + i), old_vz);
+		const simd::float4 new_vx = simd::add(simd::add(old_vx, gx), wx);
+		const simd::float4 new_vy = simd::add(simd::add(old_vy, gy), wy);
+		const simd::float4 new_vz = simd::add(simd::add(old_vz, gz), wz);
+
+		const int alive = simd::mask_ge(new_y, ground);
+		if (alive == 0xF)
+		{
+			simd::storeu(x + kept, new_x);
+			simd::storeu(y + kept, new_y);
+			simd::storeu(z + kept, new_z);
+			simd::storeu(vx + kept, new_vx);
+			simd::storeu(vy + kept, new_vy);
+			simd::storeu(vz + kept, new_vz);
+			kept += 4;
+			continue;
+		}
+
+		alignas(16) float lanes[6][4];
+		simd::store(lanes[0], new_x);
+		simd::store(lanes[1], new_y);
+		simd::store(lanes[2], new_z);
+		simd::store(lanes[3], new_vx);
+		simd::store(lanes[4], new_vy);
+		simd::store(lanes[5], new_vz);
+		for (int lane = 0; lane < 4; ++lane)
+		{
+			if (alive & (1 << lane))
+			{
+				x[kept] = lanes[0][lane];
+				y[kept] = lanes[1][lane];
+				z[kept] = lanes[2][lane];
+				vx[kept] = lanes[3][lane];
+				vy[kept] = lanes[4][lane];
+				vz[kept] = lanes[5][lane];
+				++kept;
+			}
+		}
+	}
+
+	for (; i < end; ++i)
+	{
+		const float new_y = y[i] + vy[i];
+		if (new_y >= 0.0f)
+		{
+			x[kept] = x[i] + vx[i];
+			y[kept] = new_y;
+			z[kept] = z[i] + vz[i];
+			vx[kept] = vx[i] + this->gravity_.x + this->wind_.x;
+			vy[kept] = vy[i] + this->gravity_.y + this->wind_.y;
+			vz[kept] = vz[i] + this->gravity_.z + this->wind_.z;
+			++kept;
+		}
+	}
+
+	return kept - begin;
+}
+
+void ProjectileSwarm::resize(const size_t count)
+{
+	for (std::vector<float>* component : { &this->x_, &this->y_, &this->z_, &this->vx_, &this->vy_, &this->vz_ })
+	{
+		component->resize(count);
+	}
+}
+
+Trails::Trails(const unsigned int width, const unsigned int height)
+	: width_(width), height_(height), marks_(static_cast<size_t>(width) * height) {}
+
+void Trails::plot(const ProjectileSwarm& swarm)
+{
+	const std::span<const float> xs = swarm.x();
+	const std::span<const float> ys = swarm.y();
+	for (size_t i = 0; i < xs.size(); ++i)
+	{
+		const float column = std::round(xs[i]);
+		const float row = static_cast<float>(this->height_) - std::round(ys[i]);
+		if (column >= 0.0f && column < static_cast<float>(this->width_) && row >= 0.0f && row < static_cast<float>(this->height_))
+		{
+			this->marks_[static_cast<size_t>(row) * this->width_ + static_cast<size_t>(column)] = 1;
+		}
+	}
+}
+
+void Trails::write_to(Canvas& canvas, const color& trail, const color& background) const
+{
+	std::vector<color> pixels(this->marks_.size());
+	for (size_t i = 0; i < pixels.size(); ++i)
+	{
+		pixels[i] = this->marks_[i] ? trail : background;
+	}
+
+	canvas.write_block(0, 0, this->width_, this->height_, pixels.data());
+}
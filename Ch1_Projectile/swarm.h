@@ -0,0 +1,66 @@
+#pragma once
+#include <span>
+#include <vector>
+#include "simulator.h"
+#include "../Renderer/Canvas.h"
+
+/*
+ * Many projectiles in one environment, for particle-style simulations.
+ *
+ * Positions and velocities are kept as one array per component, so a tick steps four
+ * projectiles per SIMD instruction, and large swarms are split across threads.
+ * Projectiles that fell below the ground (position.y < 0) are dropped by the tick that
+ * moved them there; the others keep their order.
+ */
+class ProjectileSwarm
+{
+	public:
+		explicit ProjectileSwarm(const Environment& environment);
+
+		void reserve(size_t count);
+		void add(const Projectile& projectile);
+
+		[[nodiscard]] size_t size() const { return this->x_.size(); }
+		[[nodiscard]] bool empty() const { return this->x_.empty(); }
+		[[nodiscard]] Projectile at(size_t index) const;
+
+		// positions, index i belonging to projectile i
+		[[nodiscard]] std::span<const float> x() const { return this->x_; }
+		[[nodiscard]] std::span<const float> y() const { return this->y_; }
+
+		/*
+		 * tick() for every projectile, then drops those below the ground.
+		 * Returns how many are left.
+		 */
+		size_t tick(unsigned int thread_count = 1);
+
+	private:
+		// added to every velocity per tick, one after the other as tick() does, so the paths match it exactly
+		rt_math::tuple gravity_, wind_;
+		std::vector<float> x_, y_, z_;
+		std::vector<float> vx_, vy_, vz_;
+
+		// steps [begin, end) and moves the survivors to the front of it, returns how many there are
+		size_t step(size_t begin, size_t end);
+		void resize(size_t count);
+};
+
+/*
+ * The pixels projectiles passed through, collected over many ticks and written
+ * to a canvas in one go instead of one write_pixel per projectile and tick.
+ */
+class Trails
+{
+	public:
+		Trails(unsigned int width, unsigned int height);
+
+		// marks the pixel under every projectile, y counting up from the bottom row; off-canvas positions are skipped
+		void plot(const ProjectileSwarm& swarm);
+
+		// writes the whole canvas, marked pixels in trail, the others in background
+		void write_to(Canvas& canvas, const rt_math::color& trail, const rt_math::color& background = rt_math::color(0, 0, 0)) const;
+
+	private:
+		unsigned int width_, height_;
+		std::vector<unsigned char> marks_;
+};
@@ -16,22 +16,26 @@ int main()
     constexpr float radius = 150.0f;
 
 
-    const rt_math::tuple top = rt_math::point(0, 1, 0);
-    std::array<rt_math::tuple, 12> hours{};
-    const std::unique_ptr<Canvas> canvas(new Canvas(width, height));
-
-    for(unsigned int i = 0; i < 12; ++i)
+    // the whole dial is a constant, every transform below is folded at compile time
+    constexpr std::array<rt_math::tuple, 12> hours = []
     {
-        // go from center THEN rotate
-        // matrix transform is reverse order.
-        const rt_math::Matrix<4> transform =
-            translation(static_cast<float>(width)/2, static_cast<float>(height)/2, 0) * 
-            rotation_z(std::numbers::pi_v<float> / 6 * static_cast<float>(i)) *
-            scaling(1, radius, 1);
-    
-    
-        hours[i] = transform * top;
-    }
+        constexpr rt_math::tuple top = rt_math::point(0, 1, 0);
+        std::array<rt_math::tuple, 12> positions{};
+
+        for(unsigned int i = 0; i < 12; ++i)
+        {
+            // go from center THEN rotate
+            // matrix transform is reverse order.
+            const rt_math::Matrix<4> transform =
+                translation(static_cast<float>(width)/2, static_cast<float>(height)/2, 0) * 
+                rotation_z(std::numbers::pi_v<float> / 6 * static_cast<float>(i)) *
+                scaling(1, radius, 1);
+
+            positions[i] = transform * top;
+        }
+        return positions;
+    }();
+    const std::unique_ptr<Canvas> canvas(new Canvas(width, height));
 
     canvas->write_pixel(width/2, height/2, color);
 
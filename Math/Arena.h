@@ -0,0 +1,203 @@
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/*
+ * Bump allocator for short-lived lists, such as the intersections collected for one ray
+ * or the scratch data of one pixel.
+ *
+ * Allocating moves a pointer, freeing a single allocation does nothing. reset() frees
+ * everything at once and keeps the blocks for reuse, so once a thread's arena has grown
+ * to what a tile needs it never calls the heap again, and threads never contend for it.
+ *
+ * mark() and rewind() free only what was allocated after the mark, for scopes nested
+ * in longer-lived ones.
+ *
+ * Not thread safe: every thread allocates from its own, see thread_arena().
+ * The tile renderer rewinds that to where it was before every tile, so nothing
+ * a shader allocates from it may be kept past its tile.
+ */
+namespace rt_math
+{
+
+class Arena
+{
+public:
+    static constexpr size_t default_block_size = 64 * 1024;
+
+    explicit Arena(const size_t block_size = default_block_size)
+        : block_size_(block_size) {}
+
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    [[nodiscard]]
+    void *allocate(const size_t bytes, const size_t alignment = alignof(std::max_align_t))
+    {
+        assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+
+        if (std::byte *p = bump(bytes, alignment))
+        {
+            return p;
+        }
+
+        // on to the next block, large enough for this allocation on its own
+        if (next_ != nullptr)
+        {
+            ++current_;
+        }
+        if (current_ == blocks_.size() || blocks_[current_].size < bytes + alignment)
+        {
+            const size_t size = std::max(block_size_, bytes + alignment);
+            blocks_.insert(blocks_.begin() + static_cast<std::ptrdiff_t>(current_), Block{ std::make_unique<std::byte[]>(size), size });
+        }
+        next_ = blocks_[current_].data.get();
+        end_ = next_ + blocks_[current_].size;
+
+        return bump(bytes, alignment);
+    }
+
+    template <typename T>
+    [[nodiscard]]
+    T *allocate(const size_t count)
+    {
+        return static_cast<T *>(allocate(count * sizeof(T), alignof(T)));
+    }
+
+    // a position to rewind to
+    struct Mark
+    {
+        size_t block = 0;
+        size_t offset = 0;
+    };
+
+    [[nodiscard]]
+    Mark mark() const
+    {
+        if (next_ == nullptr)
+        {
+            return Mark{};
+        }
+        return Mark{ current_, static_cast<size_t>(next_ - blocks_[current_].data.get()) };
+    }
+
+    // everything allocated after the mark becomes invalid, what was allocated before stays
+    void rewind(const Mark mark)
+    {
+        if (blocks_.empty())
+        {
+            return;
+        }
+
+        // blocks are only ever inserted after the current one, so the mark's block has not moved
+        current_ = mark.block;
+        next_ = blocks_[current_].data.get() + mark.offset;
+        end_ = blocks_[current_].data.get() + blocks_[current_].size;
+    }
+
+    // everything allocated so far becomes invalid, the memory stays
+    void reset()
+    {
+        current_ = 0;
+        next_ = blocks_.empty() ? nullptr : blocks_[0].data.get();
+        end_ = blocks_.empty() ? nullptr : next_ + blocks_[0].size;
+    }
+
+    // bytes held, used or not
+    [[nodiscard]]
+    size_t capacity() const
+    {
+        size_t total = 0;
+        for (const Block &block : blocks_)
+        {
+            total += block.size;
+        }
+        return total;
+    }
+
+private:
+    struct Block
+    {
+        std::unique_ptr<std::byte[]> data;
+        size_t size;
+    };
+
+    size_t block_size_;
+    std::vector<Block> blocks_;
+    // block next_ points into; blocks after it are free
+    size_t current_ = 0;
+    std::byte *next_ = nullptr;
+    std::byte *end_ = nullptr;
+
+    std::byte *bump(const size_t bytes, const size_t alignment)
+    {
+        if (next_ == nullptr)
+        {
+            return nullptr;
+        }
+
+        const size_t misalignment = reinterpret_cast<uintptr_t>(next_) & (alignment - 1);
+        std::byte *const p = next_ + (misalignment == 0 ? 0 : alignment - misalignment);
+        if (p > end_ || static_cast<size_t>(end_ - p) < bytes)
+        {
+            return nullptr;
+        }
+
+        next_ = p + bytes;
+        return p;
+    }
+};
+
+/*
+ * Standard allocator over an Arena, for containers of short-lived data.
+ * deallocate does nothing: a growing vector leaves its old buffers behind until the reset.
+ */
+template <typename T>
+class ArenaAllocator
+{
+public:
+    using value_type = T;
+
+    explicit ArenaAllocator(Arena &arena)
+        : arena_(&arena) {}
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U> &other)
+        : arena_(other.arena_) {}
+
+    [[nodiscard]]
+    T *allocate(const size_t count)
+    {
+        return arena_->allocate<T>(count);
+    }
+
+    void deallocate(T *, size_t) {}
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U> &rhs) const
+    {
+        return arena_ == rhs.arena_;
+    }
+
+private:
+    template <typename U>
+    friend class ArenaAllocator;
+
+    Arena *arena_;
+};
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+// the calling thread's arena
+inline Arena &thread_arena()
+{
+    thread_local Arena arena;
+    return arena;
+}
+
+}
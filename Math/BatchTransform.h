@@ -0,0 +1,94 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <span>
+#include "Math.h"
+#include "Parallel.h"
+#include "Simd.h"
+
+/*
+ * One Matrix<4> applied to many tuples at once, for scene preparation.
+ *
+ * Tuples come as one array per component (structure of arrays), four tuples per SIMD
+ * register. Tuples stored one per register, as everywhere else, gain nothing from batching:
+ * Matrix<4> * tuple in a loop is as fast as they go, since regrouping them in registers costs
+ * more than it saves. Batches worth speeding up are kept as component arrays instead.
+ * Results go to spans owned by the caller, which may be the input itself.
+ *
+ * thread_count > 1 splits large batches over that many threads, the caller being one of them.
+ * Nothing is allocated besides those threads.
+ */
+namespace rt_math
+{
+
+// one array per component, all of the same length
+template <typename Float>
+struct TupleArrays
+{
+    std::span<Float> x;
+    std::span<Float> y;
+    std::span<Float> z;
+    std::span<Float> w;
+
+    [[nodiscard]]
+    size_t size() const
+    {
+        return x.size();
+    }
+};
+
+/*
+ * out[i] = matrix * in[i] for component arrays: four tuples per step, every matrix entry
+ * broadcast once. The arrays need no particular alignment.
+ */
+inline void transform_tuples(const Matrix<4> &matrix, const TupleArrays<const float> &in, const TupleArrays<float> &out, const unsigned int thread_count = 1)
+{
+    const size_t count = in.size();
+    assert(in.y.size() == count && in.z.size() == count && in.w.size() == count);
+    assert(out.x.size() >= count && out.y.size() >= count && out.z.size() >= count && out.w.size() >= count);
+
+    for_each_chunk(count, thread_count, [&matrix, &in, &out](const size_t begin, const size_t end)
+    {
+        simd::float4 m[16];
+        for (size_t i = 0; i < 16; ++i)
+        {
+            m[i] = simd::set1(matrix.at(i / 4, i % 4));
+        }
+
+        const float *const x = in.x.data(), *const y = in.y.data(), *const z = in.z.data(), *const w = in.w.data();
+        float *const out_x = out.x.data(), *const out_y = out.y.data(), *const out_z = out.z.data(), *const out_w = out.w.data();
+
+        size_t i = begin;
+        for (; i + 4 <= end; i += 4)
+        {
+            const simd::float4 vx = simd::loadu(x + i);
+            const simd::float4 vy = simd::loadu(y + i);
+            const simd::float4 vz = simd::loadu(z + i);
+            const simd::float4 vw = simd::loadu(w + i);
+
+            const auto row = [&](const size_t r)
+            {
+                return simd::add(
+                    simd::add(simd::mul(m[r * 4], vx), simd::mul(m[r * 4 + 1], vy)),
+                    simd::add(simd::mul(m[r * 4 + 2], vz), simd::mul(m[r * 4 + 3], vw)));
+            };
+            // all four rows are computed before any store, in case out is in
+            const simd::float4 rx = row(0), ry = row(1), rz = row(2), rw = row(3);
+            simd::storeu(out_x + i, rx);
+            simd::storeu(out_y + i, ry);
+            simd::storeu(out_z + i, rz);
+            simd::storeu(out_w + i, rw);
+        }
+
+        for (; i < end; ++i)
+        {
+            const tuple result = matrix * tuple{ x[i], y[i], z[i], w[i] };
+            out_x[i] = result.x;
+            out_y[i] = result.y;
+            out_z[i] = result.z;
+            out_w[i] = result.w;
+        }
+    });
+}
+
+}
@@ -0,0 +1,437 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "Geometry.h"
+
+/*
+ * Axis aligned bounding box
+ */
+struct Bounds
+{
+    std::array<float, 3> min = {
+        std::numeric_limits<float>::infinity(),
+        std::numeric_limits<float>::infinity(),
+        std::numeric_limits<float>::infinity()
+    };
+    std::array<float, 3> max = {
+        -std::numeric_limits<float>::infinity(),
+        -std::numeric_limits<float>::infinity(),
+        -std::numeric_limits<float>::infinity()
+    };
+
+    void grow(const tuple &p)
+    {
+        const std::array<float, 3> coordinates = { p.x, p.y, p.z };
+        for (size_t axis = 0; axis < 3; ++axis)
+        {
+            min[axis] = std::min(min[axis], coordinates[axis]);
+            max[axis] = std::max(max[axis], coordinates[axis]);
+        }
+    }
+
+    void grow(const Bounds &other)
+    {
+        for (size_t axis = 0; axis < 3; ++axis)
+        {
+            min[axis] = std::min(min[axis], other.min[axis]);
+            max[axis] = std::max(max[axis], other.max[axis]);
+        }
+    }
+
+    [[nodiscard]]
+    bool empty() const
+    {
+        return min[0] > max[0];
+    }
+
+    /*
+     * In double: squared float extents overflow float beyond about 1e19,
+     * in double they stay finite for any finite bounds.
+     */
+    [[nodiscard]]
+    double surface_area() const
+    {
+        if (empty())
+        {
+            return 0;
+        }
+
+        const double dx = static_cast<double>(max[0]) - min[0];
+        const double dy = static_cast<double>(max[1]) - min[1];
+        const double dz = static_cast<double>(max[2]) - min[2];
+        return 2 * (dx * dy + dy * dz + dz * dx);
+    }
+
+    [[nodiscard]]
+    float centroid(const size_t axis) const
+    {
+        return (min[axis] + max[axis]) * 0.5f;
+    }
+
+    /*
+     * Slab test. Returns distance where the ray enters the box,
+     * or infinity if it misses or enters beyond t_max.
+     */
+    [[nodiscard]]
+    float entry(const tuple &origin, const std::array<float, 3> &inv_direction, const float t_max) const
+    {
+        const std::array<float, 3> o = { origin.x, origin.y, origin.z };
+
+        float t_near = 0;
+        float t_far = t_max;
+        for (size_t axis = 0; axis < 3; ++axis)
+        {
+            float t0 = (min[axis] - o[axis]) * inv_direction[axis];
+            float t1 = (max[axis] - o[axis]) * inv_direction[axis];
+            if (t0 > t1)
+            {
+                std::swap(t0, t1);
+            }
+
+            t_near = std::max(t_near, t0);
+            t_far = std::min(t_far, t1);
+        }
+
+        return t_near <= t_far ? t_near : std::numeric_limits<float>::infinity();
+    }
+};
+
+/*
+ * Bounds of a transformed unit sphere: the eight corners of its object space box, transformed.
+ */
+inline Bounds bounds(const Sphere &sphere)
+{
+    const Affine &matrix = sphere.transformation().matrix();
+
+    Bounds box;
+    for (int corner = 0; corner < 8; ++corner)
+    {
+        box.grow(matrix * point(
+            corner & 1 ? 1.0f : -1.0f,
+            corner & 2 ? 1.0f : -1.0f,
+            corner & 4 ? 1.0f : -1.0f
+        ));
+    }
+
+    return box;
+}
+
+/*
+ * Bounding volume hierarchy over spheres, built with the surface area heuristic.
+ *
+ * Nodes are flattened depth first into one array: the left child of an interior node
+ * is the next node, only the right child index is stored.
+ * Leaves index a contiguous range of primitive indices.
+ *
+ * Below median_split_depth every split halves its range instead, which bounds the depth
+ * at max_depth whatever the input, so traversal fits a fixed stack.
+ *
+ * The spheres are not copied, the vector passed in must outlive the Bvh
+ * and not change while it is used.
+ */
+class Bvh
+{
+public:
+    struct Node
+    {
+        Bounds bounds;
+        // leaf: first primitive index; interior: index of the right child
+        uint32_t offset = 0;
+        // 0 for interior nodes
+        uint16_t count = 0;
+        uint16_t axis = 0;
+    };
+
+    static constexpr size_t max_leaf_size = 4;
+    // primitive indices are 32 bit, so halving reaches single primitives within 32 levels
+    static constexpr size_t max_depth = 60;
+    static constexpr size_t median_split_depth = max_depth - 32;
+
+    explicit Bvh(const std::vector<Sphere> &spheres);
+
+    [[nodiscard]]
+    SphereHit closest_hit(const Ray &ray) const;
+
+    [[nodiscard]]
+    const std::vector<Node> &nodes() const
+    {
+        return nodes_;
+    }
+
+private:
+    static constexpr size_t bin_count = 12;
+
+    const std::vector<Sphere> *spheres_;
+    std::vector<uint32_t> indices_;
+    std::vector<Node> nodes_;
+
+    // per primitive, only needed while building
+    struct BuildPrimitive
+    {
+        Bounds bounds;
+        std::array<float, 3> centroid;
+    };
+
+    void build(std::vector<BuildPrimitive> &primitives, size_t begin, size_t end, size_t depth);
+    // partitions [begin, end) around its median centroid on the axis of largest extent, returns the middle
+    size_t median_split(const std::vector<BuildPrimitive> &primitives, size_t node_index, size_t begin, size_t end, const Bounds &centroid_bounds);
+};
+
+inline Bvh::Bvh(const std::vector<Sphere> &spheres) : spheres_(&spheres)
+{
+    std::vector<BuildPrimitive> primitives(spheres.size());
+    indices_.resize(spheres.size());
+    for (size_t i = 0; i < spheres.size(); ++i)
+    {
+        primitives[i].bounds = bounds(spheres[i]);
+        for (size_t axis = 0; axis < 3; ++axis)
+        {
+            primitives[i].centroid[axis] = primitives[i].bounds.centroid(axis);
+        }
+        indices_[i] = static_cast<uint32_t>(i);
+    }
+
+    if (!spheres.empty())
+    {
+        nodes_.reserve(2 * spheres.size());
+        build(primitives, 0, spheres.size(), 0);
+    }
+}
+
+inline void Bvh::build(std::vector<BuildPrimitive> &primitives, const size_t begin, const size_t end, const size_t depth)
+{
+    const size_t node_index = nodes_.size();
+    nodes_.emplace_back();
+
+    Bounds node_bounds;
+    Bounds centroid_bounds;
+    for (size_t i = begin; i < end; ++i)
+    {
+        const BuildPrimitive &primitive = primitives[indices_[i]];
+        node_bounds.grow(primitive.bounds);
+        centroid_bounds.grow(point(primitive.centroid[0], primitive.centroid[1], primitive.centroid[2]));
+    }
+    nodes_[node_index].bounds = node_bounds;
+
+    const size_t count = end - begin;
+    const auto make_leaf = [&]()
+    {
+        nodes_[node_index].offset = static_cast<uint32_t>(begin);
+        nodes_[node_index].count = static_cast<uint16_t>(count);
+    };
+
+    if (count <= 1)
+    {
+        make_leaf();
+        return;
+    }
+
+    const auto split_at_median = [&]()
+    {
+        const size_t middle = median_split(primitives, node_index, begin, end, centroid_bounds);
+        build(primitives, begin, middle, depth + 1);
+        nodes_[node_index].offset = static_cast<uint32_t>(nodes_.size());
+        build(primitives, middle, end, depth + 1);
+    };
+
+    if (depth >= median_split_depth)
+    {
+        if (count <= max_leaf_size)
+        {
+            make_leaf();
+            return;
+        }
+        split_at_median();
+        return;
+    }
+
+    // binned SAH: cost of a split = area(left) * count(left) + area(right) * count(right)
+    double best_cost = std::numeric_limits<double>::infinity();
+    size_t best_axis = 0;
+    size_t best_split = 0;
+    for (size_t axis = 0; axis < 3; ++axis)
+    {
+        const float extent = centroid_bounds.max[axis] - centroid_bounds.min[axis];
+        if (!(extent > 0) || !std::isfinite(extent))
+        {
+            continue;
+        }
+
+        std::array<Bounds, bin_count> bins;
+        std::array<size_t, bin_count> bin_sizes = {};
+        const float scale = static_cast<float>(bin_count) / extent;
+        for (size_t i = begin; i < end; ++i)
+        {
+            const BuildPrimitive &primitive = primitives[indices_[i]];
+            const size_t bin = std::min(bin_count - 1, static_cast<size_t>((primitive.centroid[axis] - centroid_bounds.min[axis]) * scale));
+            bins[bin].grow(primitive.bounds);
+            ++bin_sizes[bin];
+        }
+
+        // sweep from the right, then from the left, to get both sides of every split plane
+        std::array<double, bin_count> right_costs = {};
+        Bounds right;
+        size_t right_size = 0;
+        for (size_t bin = bin_count - 1; bin > 0; --bin)
+        {
+            right.grow(bins[bin]);
+            right_size += bin_sizes[bin];
+            right_costs[bin] = right.surface_area() * static_cast<double>(right_size);
+        }
+
+        Bounds left;
+        size_t left_size = 0;
+        for (size_t split = 1; split < bin_count; ++split)
+        {
+            left.grow(bins[split - 1]);
+            left_size += bin_sizes[split - 1];
+            const double cost = left.surface_area() * static_cast<double>(left_size) + right_costs[split];
+            if (cost < best_cost)
+            {
+                best_cost = cost;
+                best_axis = axis;
+                best_split = split;
+            }
+        }
+    }
+
+    const double leaf_cost = node_bounds.surface_area() * static_cast<double>(count);
+    if (best_split == 0)
+    {
+        // all centroids coincide, nothing separates them, or the bounds are infinite and no cost compares
+        const bool coincident = centroid_bounds.min == centroid_bounds.max;
+        if (count <= max_leaf_size || (coincident && count <= std::numeric_limits<uint16_t>::max()))
+        {
+            make_leaf();
+            return;
+        }
+        split_at_median();
+        return;
+    }
+
+    if (count <= max_leaf_size && leaf_cost <= best_cost)
+    {
+        // splitting does not pay off
+        make_leaf();
+        return;
+    }
+
+    const float extent = centroid_bounds.max[best_axis] - centroid_bounds.min[best_axis];
+    const float scale = static_cast<float>(bin_count) / extent;
+    const auto split_at = std::partition(
+        indices_.begin() + static_cast<std::ptrdiff_t>(begin),
+        indices_.begin() + static_cast<std::ptrdiff_t>(end),
+        [&](const uint32_t index)
+        {
+            const float centroid = primitives[index].centroid[best_axis];
+            const size_t bin = std::min(bin_count - 1, static_cast<size_t>((centroid - centroid_bounds.min[best_axis]) * scale));
+            return bin < best_split;
+        });
+    const size_t middle = static_cast<size_t>(split_at - indices_.begin());
+
+    nodes_[node_index].axis = static_cast<uint16_t>(best_axis);
+    build(primitives, begin, middle, depth + 1);
+    nodes_[node_index].offset = static_cast<uint32_t>(nodes_.size());
+    build(primitives, middle, end, depth + 1);
+}
+
+inline size_t Bvh::median_split(const std::vector<BuildPrimitive> &primitives, const size_t node_index, const size_t begin, const size_t end, const Bounds &centroid_bounds)
+{
+    size_t axis = 0;
+    double widest = -1;
+    for (size_t a = 0; a < 3; ++a)
+    {
+        const double extent = static_cast<double>(centroid_bounds.max[a]) - centroid_bounds.min[a];
+        if (extent > widest)
+        {
+            widest = extent;
+            axis = a;
+        }
+    }
+
+    nodes_[node_index].axis = static_cast<uint16_t>(axis);
+    const size_t middle = begin + (end - begin) / 2;
+    std::nth_element(
+        indices_.begin() + static_cast<std::ptrdiff_t>(begin),
+        indices_.begin() + static_cast<std::ptrdiff_t>(middle),
+        indices_.begin() + static_cast<std::ptrdiff_t>(end),
+        [&](const uint32_t a, const uint32_t b)
+        {
+            return primitives[a].centroid[axis] < primitives[b].centroid[axis];
+        });
+
+    return middle;
+}
+
+inline SphereHit Bvh::closest_hit(const Ray &ray) const
+{
+    SphereHit best;
+    if (nodes_.empty())
+    {
+        return best;
+    }
+
+    const std::array<float, 3> inv_direction = {
+        1.0f / ray.direction().x,
+        1.0f / ray.direction().y,
+        1.0f / ray.direction().z
+    };
+    const std::array<bool, 3> negative = {
+        inv_direction[0] < 0,
+        inv_direction[1] < 0,
+        inv_direction[2] < 0
+    };
+
+    // holds at most one waiting sibling per level below the current node
+    std::array<uint32_t, max_depth + 2> stack;
+    size_t stack_size = 0;
+    stack[stack_size++] = 0;
+
+    while (stack_size > 0)
+    {
+        const Node &node = nodes_[stack[--stack_size]];
+        if (node.bounds.entry(ray.origin(), inv_direction, best.t) == std::numeric_limits<float>::infinity())
+        {
+            continue;
+        }
+
+        if (node.count > 0)
+        {
+            for (uint32_t i = node.offset; i < node.offset + node.count; ++i)
+            {
+                Intersections xs;
+                (*spheres_)[indices_[i]].intersects(ray, xs);
+                for (size_t k = 0; k < xs.size(); ++k)
+                {
+                    if (xs[k] >= 0 && xs[k] < best.t)
+                    {
+                        best.t = xs[k];
+                        best.index = indices_[i];
+                    }
+                }
+            }
+            continue;
+        }
+
+        // visit the near child first, so the far one can be culled by best.t
+        const uint32_t left = static_cast<uint32_t>(&node - nodes_.data()) + 1;
+        const uint32_t right = node.offset;
+        assert(stack_size + 2 <= stack.size());
+        if (negative[node.axis])
+        {
+            stack[stack_size++] = left;
+            stack[stack_size++] = right;
+        }
+        else
+        {
+            stack[stack_size++] = right;
+            stack[stack_size++] = left;
+        }
+    }
+
+    return best;
+}
@@ -1,37 +1,156 @@
 #pragma once
+#include <array>
+#include <limits>
+#include <type_traits>
+#include <vector>
+#include "Arena.h"
+#include "Math.h"
+#include "Transform.h"
+#include "Stats.h"
 
 using namespace rt_math;
 
+/*
+ * Plain value: trivially copyable and nothing but its two tuples,
+ * so rays can be memcpy'd, packed and kept by the million in flat buffers.
+ */
 struct Ray
 {
-
 public:
     Ray(const tuple origin, const tuple direction)
     : m_origin(origin), m_direction(direction) {}
 
-    tuple &origin = m_origin;
-    tuple &direction = m_direction;
+    [[nodiscard]]
+    const tuple &origin() const
+    {
+        return m_origin;
+    }
+
+    [[nodiscard]]
+    const tuple &direction() const
+    {
+        return m_direction;
+    }
 
 private:
     tuple m_origin;
     tuple m_direction;
 };
 
+static_assert(std::is_trivially_copyable_v<Ray>, "rays are copied as bytes");
+static_assert(sizeof(Ray) == 2 * sizeof(tuple), "Ray holds its origin and direction only");
+
+/*
+ * Fixed capacity hit record. A ray crosses a sphere in at most two places,
+ * so the distances fit on the stack and intersecting never allocates.
+ */
+struct Intersections
+{
+    static constexpr size_t capacity = 2;
+
+    std::array<float, capacity> t = {};
+    size_t count = 0;
+
+    [[nodiscard]]
+    size_t size() const
+    {
+        return count;
+    }
+
+    [[nodiscard]]
+    bool empty() const
+    {
+        return count == 0;
+    }
+
+    float operator[](const size_t index) const
+    {
+        assert(index < count);
+        return t[index];
+    }
+};
+
+/*
+ * Result of a closest hit query over many spheres (SphereSet, Bvh).
+ * t is the lowest non negative intersection over all spheres, as in the book's hit().
+ */
+struct SphereHit
+{
+    static constexpr size_t none = std::numeric_limits<size_t>::max();
+
+    size_t index = none;
+    float t = std::numeric_limits<float>::infinity();
+
+    [[nodiscard]]
+    bool hit() const
+    {
+        return index != none;
+    }
+};
+
+/*
+ * Unit sphere around origin(), placed in the world by its transformation.
+ * Trivially copyable like Ray.
+ */
 struct Sphere
 {
 public:
     Sphere();
-    tuple &origin = m_origin;
+
+    [[nodiscard]]
+    const tuple &origin() const
+    {
+        return m_origin;
+    }
+
     [[nodiscard]]
     std::vector<float> intersects(const Ray &) const;
+    /*
+     * Hot path version. Overwrites xs with the hit distances, no heap allocation.
+     */
+    void intersects(const Ray &, Intersections &xs) const;
+    /*
+     * Appends the hit distances to xs, so the hits of many objects can be collected
+     * in one list allocated from an arena instead of the heap.
+     */
+    void intersects(const Ray &, ArenaVector<float> &xs) const;
+
+    [[nodiscard]]
+    const Transform &transformation() const
+    {
+        return m_transform;
+    }
+
+    void set_transform(const Transform &transform)
+    {
+        m_transform = transform;
+    }
 private:
     tuple m_origin;
+    Transform m_transform;
 };
 
+static_assert(std::is_trivially_copyable_v<Sphere>, "spheres are copied as bytes");
+static_assert(sizeof(Sphere) == sizeof(tuple) + sizeof(Transform), "Sphere holds its origin and transformation only");
+
 
 inline tuple position(const Ray ray, const float distance)
 {
-    return ray.origin + ray.direction * distance;
+    return ray.origin() + ray.direction() * distance;
+}
+
+/*
+ * Direction is not normalized on purpose, so distances found in object space
+ * are valid for the world space ray as well.
+ */
+inline Ray transform(const Ray &ray, const Matrix<4> &matrix)
+{
+    return Ray(matrix * ray.origin(), matrix * ray.direction());
+}
+
+inline Ray transform(const Ray &ray, const Affine &matrix)
+{
+    return Ray(matrix * ray.origin(), matrix * ray.direction());
 }
 
 
@@ -40,26 +159,51 @@ inline Sphere::Sphere()
     m_origin = point(0, 0, 0);
 }
 
-[[nodiscard]]
-inline std::vector<float> Sphere::intersects(const Ray &ray) const
+inline void Sphere::intersects(const Ray &world_ray, Intersections &xs) const
 {
+    // instead of moving the sphere, move the ray by the (precomputed) inverse
+    const Ray ray = transform(world_ray, m_transform.inverse());
+
     // vector from the sphere's center, to the ray origin
-    // sphere is centered at the world origin
-    const tuple sphere_to_ray = ray.origin - point(0, 0, 0);
-    const float a = dot(ray.direction, ray.direction);
-    const float b = 2 * dot(ray.direction, sphere_to_ray);
+    // sphere is centered at the object space origin
+    const tuple sphere_to_ray = ray.origin() - point(0, 0, 0);
+    const float a = dot(ray.direction(), ray.direction());
+    const float b = 2 * dot(ray.direction(), sphere_to_ray);
     const float c = dot(sphere_to_ray, sphere_to_ray) - 1;
 
     const float discriminant = b * b - 4 * a * c;
 
+    RT_STAT_ADD(intersection_tests, 1);
     if (discriminant < 0)
     {
-        return std::vector<float>(0);
+        xs.count = 0;
+        return;
     }
 
-    return std::vector<float>
-    {
-        (-b - std::sqrt(discriminant)) / (2 * a),
-        (-b + std::sqrt(discriminant)) / (2 * a)
-    };
+    RT_STAT_ADD(hits, 1);
+
+    const float sqrt_discriminant = std::sqrt(discriminant);
+    xs.t[0] = (-b - sqrt_discriminant) / (2 * a);
+    xs.t[1] = (-b + sqrt_discriminant) / (2 * a);
+    xs.count = 2;
+}
+
+inline void Sphere::intersects(const Ray &ray, ArenaVector<float> &xs) const
+{
+    Intersections hits;
+    this->intersects(ray, hits);
+
+    xs.insert(xs.end(), hits.t.begin(), hits.t.begin() + hits.count);
+}
+
+/*
+ * Convenience wrapper over the allocation free version.
+ */
+[[nodiscard]]
+inline std::vector<float> Sphere::intersects(const Ray &ray) const
+{
+    Intersections xs;
+    this->intersects(ray, xs);
+
+    return std::vector<float>(xs.t.begin(), xs.t.begin() + xs.count);
 }
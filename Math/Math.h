@@ -4,14 +4,75 @@
 #include <array>
 #include <stack>
 #include <initializer_list>
+#include <numbers>
+#include <type_traits>
+#include "Simd.h"
 
 namespace rt_math
 {
 
 constexpr float EPSILON = 0.00001f;
-inline bool eq_f(float const a, float const b)
+constexpr bool eq_f(float const a, float const b)
 {
-    return std::abs(a - b) < EPSILON;
+    // std::abs is not constexpr before C++23
+    const float difference = a - b;
+    return (difference < 0 ? -difference : difference) < EPSILON;
+}
+
+namespace detail
+{
+// Taylor series of sin, enough terms for float precision on [-pi/2, pi/2]
+constexpr double sin_series(const double x)
+{
+    double term = x;
+    double sum = x;
+    for (int i = 1; i < 10; ++i)
+    {
+        term *= -x * x / ((2.0 * i) * (2.0 * i + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr double sin_reduced(double x)
+{
+    // whole turns first, then fold [-pi, pi] onto [-pi/2, pi/2] by sin(x) = sin(pi - x)
+    constexpr double pi = std::numbers::pi;
+    const double turns = x / (2 * pi);
+    x -= 2 * pi * static_cast<double>(static_cast<long long>(turns + (turns < 0 ? -0.5 : 0.5)));
+
+    if (x > pi / 2)
+    {
+        x = pi - x;
+    }
+    else if (x < -pi / 2)
+    {
+        x = -pi - x;
+    }
+    return sin_series(x);
+}
+}
+
+/*
+ * sin and cos usable in constant expressions, so rotations can be built at compile time.
+ * At run time they are std::sin and std::cos.
+ */
+constexpr float constexpr_sin(const float angle)
+{
+    if (std::is_constant_evaluated())
+    {
+        return static_cast<float>(detail::sin_reduced(angle));
+    }
+    return std::sin(angle);
+}
+
+constexpr float constexpr_cos(const float angle)
+{
+    if (std::is_constant_evaluated())
+    {
+        return static_cast<float>(detail::sin_reduced(static_cast<double>(angle) + std::numbers::pi / 2));
+    }
+    return std::cos(angle);
 }
 
 template <typename T>
@@ -26,18 +87,34 @@ inline bool eq(const float lhs, const float rhs)
     return eq_f(lhs, rhs);
 }
 
-struct tuple
+/*
+ * 16 byte aligned so the four components load straight into one SIMD register.
+ */
+struct alignas(16) tuple
 {
     float x; float y; float z; float w;
 
     [[nodiscard]]
-    bool IsPoint() const
+    simd::float4 lanes() const
+    {
+        return simd::load(&x);
+    }
+
+    static tuple from_lanes(const simd::float4 lanes)
+    {
+        tuple result;
+        simd::store(&result.x, lanes);
+        return result;
+    }
+
+    [[nodiscard]]
+    constexpr bool IsPoint() const
     {
         return w == 1.0f;
     }
 
     [[nodiscard]]
-    bool IsVector() const
+    constexpr bool IsVector() const
     {
         return w == 0.0f;
     }
@@ -58,9 +135,13 @@ struct tuple
      * Adding w=1 (point) to a w=1 (point) produces w=2, undefined here,
      *   which matches the fact that mathematically cannot add point and a point.
      */
-    tuple operator+(const tuple &rhs) const
+    constexpr tuple operator+(const tuple &rhs) const
     {
-        return tuple(x + rhs.x, y + rhs.y, z + rhs.z, w + rhs.w);
+        if (std::is_constant_evaluated())
+        {
+            return tuple(x + rhs.x, y + rhs.y, z + rhs.z, w + rhs.w);
+        }
+        return from_lanes(simd::add(lanes(), rhs.lanes()));
     }
 
     /*
@@ -69,31 +150,49 @@ struct tuple
      *
      * Useful for chapter 6 - finding vector pointing to light source.
      */
-    tuple operator-(const tuple &rhs) const
+    constexpr tuple operator-(const tuple &rhs) const
     {
-        return tuple(x - rhs.x, y - rhs.y, z - rhs.z, w - rhs.w);
+        if (std::is_constant_evaluated())
+        {
+            return tuple(x - rhs.x, y - rhs.y, z - rhs.z, w - rhs.w);
+        }
+        return from_lanes(simd::sub(lanes(), rhs.lanes()));
     }
 
     /*
      * Negating vector. Useful for chapter 6 - shading.
      */
-    tuple operator-() const
+    constexpr tuple operator-() const
     {
-        return tuple(0 - x, 0 - y, 0 - z, 0 - w);
+        if (std::is_constant_evaluated())
+        {
+            return tuple(-x, -y, -z, -w);
+        }
+        return from_lanes(simd::sub(simd::zero(), lanes()));
     }
 
-    tuple operator*(float const a) const
+    constexpr tuple operator*(float const a) const
     {
-        return tuple(x * a, y * a, z * a, w * a);
+        if (std::is_constant_evaluated())
+        {
+            return tuple(x * a, y * a, z * a, w * a);
+        }
+        return from_lanes(simd::mul(lanes(), simd::set1(a)));
     }
-    tuple operator/(float const a) const
+    constexpr tuple operator/(float const a) const
     {
-        return tuple(x / a, y / a, z / a, w / a);
+        if (std::is_constant_evaluated())
+        {
+            return tuple(x / a, y / a, z / a, w / a);
+        }
+        return from_lanes(simd::div(lanes(), simd::set1(a)));
     }
 };
 
+static_assert(sizeof(tuple) == 16 && alignof(tuple) == 16, "tuple must fill exactly one SIMD register");
+
 // typedef tuple point;
-inline bool operator==(const tuple &lhs, const tuple &rhs)
+constexpr bool operator==(const tuple &lhs, const tuple &rhs)
 {
     return eq_f(lhs.x, rhs.x)
         && eq_f(lhs.y, rhs.y)
@@ -101,84 +200,120 @@ inline bool operator==(const tuple &lhs, const tuple &rhs)
         && eq_f(lhs.w, rhs.w);
 }
 
-inline bool operator!=(const tuple &lhs, const tuple &rhs)
+constexpr bool operator!=(const tuple &lhs, const tuple &rhs)
 {
     return !(lhs == rhs);
 }
 
-tuple inline vector(const float x, const float y, const float z)
+constexpr tuple vector(const float x, const float y, const float z)
 {
     return tuple(x, y, z, 0);
 }
-tuple inline point(const float x, const float y, const float z)
+constexpr tuple point(const float x, const float y, const float z)
 {
     return tuple(x, y, z, 1);
 }
 
-inline float dot(const tuple &a, const tuple &b)
+constexpr float dot(const tuple &a, const tuple &b)
 {
     assert(a.IsVector() && b.IsVector());
 
-    return a.x * b.x + a.y * b.y + a.z * b.z;
+    if (std::is_constant_evaluated())
+    {
+        return a.x * b.x + a.y * b.y + a.z * b.z;
+    }
+    return simd::dot3(a.lanes(), b.lanes());
 }
 
-inline tuple cross(const tuple &a, const tuple &b)
+constexpr tuple cross(const tuple &a, const tuple &b)
 {
     assert(a.IsVector() && b.IsVector());
 
-    return vector(
-        a.y * b.z - a.z * b.y,
-        a.z * b.x - a.x * b.z,
-        a.x * b.y - a.y * b.x
-    );
+    if (std::is_constant_evaluated())
+    {
+        return vector(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+    }
+    return tuple::from_lanes(simd::cross3(a.lanes(), b.lanes()));
 }
 
 inline tuple normalize(const tuple &v)
 {
     assert(v.IsVector());
 
+    // w of a vector is 0, so dividing all four lanes keeps it a vector
     const float magnitude = v.magnitude();
-    return vector(
-        v.x / magnitude,
-        v.y / magnitude,
-        v.z / magnitude
-    );
+    return tuple::from_lanes(simd::div(v.lanes(), simd::set1(magnitude)));
 }
 
-struct color
+/*
+ * Padded to four lanes, same as tuple. The pad lane is never read back;
+ * it defaults to 0 so that colors can be brace initialised from three channels.
+ */
+struct alignas(16) color
 {
-    float red; float green; float blue;
+    float red; float green; float blue; float pad = 0.0f;
+
+    [[nodiscard]]
+    simd::float4 lanes() const
+    {
+        return simd::load(&red);
+    }
 
-    color operator+(const color &rhs) const
+    static color from_lanes(const simd::float4 lanes)
     {
-        return color(red + rhs.red, green + rhs.green, blue + rhs.blue);
+        color result;
+        simd::store(&result.red, lanes);
+        return result;
+    }
+
+    constexpr color operator+(const color &rhs) const
+    {
+        if (std::is_constant_evaluated())
+        {
+            return color(red + rhs.red, green + rhs.green, blue + rhs.blue, pad + rhs.pad);
+        }
+        return from_lanes(simd::add(lanes(), rhs.lanes()));
     }
-    color operator-(const color &rhs) const
+    constexpr color operator-(const color &rhs) const
     {
-        return color(red - rhs.red, green - rhs.green, blue - rhs.blue);
+        if (std::is_constant_evaluated())
+        {
+            return color(red - rhs.red, green - rhs.green, blue - rhs.blue, pad - rhs.pad);
+        }
+        return from_lanes(simd::sub(lanes(), rhs.lanes()));
     }
 
-    color operator*(const float rhs) const
+    constexpr color operator*(const float rhs) const
     {
-        return color(red * rhs, green * rhs, blue * rhs);
+        if (std::is_constant_evaluated())
+        {
+            return color(red * rhs, green * rhs, blue * rhs, pad * rhs);
+        }
+        return from_lanes(simd::mul(lanes(), simd::set1(rhs)));
     }
 
     /*
      * Hadamard product
      */
-    color operator*(const color &rhs) const
+    constexpr color operator*(const color &rhs) const
     {
-        return color(red * rhs.red, green * rhs.green, blue * rhs.blue);
+        if (std::is_constant_evaluated())
+        {
+            return color(red * rhs.red, green * rhs.green, blue * rhs.blue, pad * rhs.pad);
+        }
+        return from_lanes(simd::mul(lanes(), rhs.lanes()));
     }
 };
 
-inline bool operator==(const color &lhs, const color &rhs)
+static_assert(sizeof(color) == 16 && alignof(color) == 16, "color must fill exactly one SIMD register");
+
+constexpr bool operator==(const color &lhs, const color &rhs)
 {
     return eq_f(lhs.red, rhs.red)
         && eq_f(lhs.green, rhs.green)
         && eq_f(lhs.blue, rhs.blue);
 } 
-inline bool operator!=(const color &lhs, const color &rhs)
+constexpr bool operator!=(const color &lhs, const color &rhs)
 {
     return !(lhs == rhs);
 }
@@ -187,7 +322,9 @@ template <size_t N>
 class Matrix
 {
 public:
-    Matrix(const std::initializer_list<float> args)
+    static constexpr size_t size = N;
+
+    constexpr Matrix(const std::initializer_list<float> args)
     {
         assert(args.size() == N * N);
 
@@ -198,13 +335,13 @@ public:
             i++;
         }
     }
-    Matrix(std::array<float, N*N> &&values) : matrix_(std::move(values)) {}
-    Matrix(const std::array<float, N*N> &values) : matrix_(std::move(values)) {}
+    constexpr Matrix(std::array<float, N*N> &&values) : matrix_(std::move(values)) {}
+    constexpr Matrix(const std::array<float, N*N> &values) : matrix_(values) {}
 
     /*
      * Could optionally generalize into hardcoded versions of identity matrices
      */
-    static Matrix identity_matrix()
+    static constexpr Matrix identity_matrix()
     {
         std::array<float, N * N> tmpM = {};
         for (size_t row = 0; row < N; ++row)
@@ -219,17 +356,17 @@ public:
     }
 
     [[nodiscard]]
-    float at(const size_t row, const size_t column) const
+    constexpr float at(const size_t row, const size_t column) const
     {
         const size_t index = row * N + column;
         return matrix_[index];
     }
 
     [[nodiscard]]
-    float determinant() const;
+    constexpr float determinant() const;
 
     [[nodiscard]]
-    Matrix<N-1> submatrix(const unsigned int row, const unsigned int column) const
+    constexpr Matrix<N-1> submatrix(const unsigned int row, const unsigned int column) const
     {
         std::array<float, (N-1) * (N-1)> tmpM;
 
@@ -266,13 +403,13 @@ public:
     }
 
     [[nodiscard]]
-    float minor(const unsigned int row, const unsigned int column) const
+    constexpr float minor(const unsigned int row, const unsigned int column) const
     {
         return this->submatrix(row, column).determinant();
     }
 
     [[nodiscard]]
-    float cofactor(const unsigned int row, const unsigned int column) const
+    constexpr float cofactor(const unsigned int row, const unsigned int column) const
     {
         float minor = this->minor(row, column);
         if ((row + column) % 2 != 0)
@@ -284,13 +421,38 @@ public:
     }
 
     [[nodiscard]]
-    bool is_invertible() const
+    constexpr bool is_invertible() const
     {
         return this->determinant() != 0.0f;
     }
 
     [[nodiscard]]
-    Matrix<N> inverse() const
+    constexpr Matrix<N> inverse() const
+    {
+        return this->cofactor_inverse();
+    }
+
+    /*
+     * Bottom row is 0 0 0 1, as for every matrix built by the transformation functions.
+     */
+    [[nodiscard]]
+    constexpr bool is_affine() const
+    {
+        static_assert(N == 4, "Affine transforms are 4x4.");
+
+        return matrix_[12] == 0.0f && matrix_[13] == 0.0f && matrix_[14] == 0.0f && matrix_[15] == 1.0f;
+    }
+
+    [[nodiscard]]
+    constexpr Matrix<N> affine_inverse() const;
+
+    /*
+     * Generic adjugate / determinant inverse.
+     * Builds a submatrix and recurses for every cofactor, so it is slow.
+     * Kept as the reference implementation for other sizes and for comparison in tests and benchmarks.
+     */
+    [[nodiscard]]
+    constexpr Matrix<N> cofactor_inverse() const
     {
         std::array<float, N*N> tmpCofactors = {};
 
@@ -319,7 +481,19 @@ public:
         return transposed_cofactors;
     }
 
-    Matrix operator*(const Matrix &rhs) const
+    // a Matrix is the simplest matrix expression, it evaluates to itself
+    [[nodiscard]]
+    constexpr const Matrix &evaluate() const
+    {
+        return *this;
+    }
+
+    /*
+     * Eager product. operator* builds a lazy MatrixProduct instead, which ends up here
+     * only once the chain has to become a matrix.
+     */
+    [[nodiscard]]
+    constexpr Matrix multiply(const Matrix &rhs) const
     {
         std::array<float, N*N> tmpM = {};
         size_t i = 0;
@@ -344,7 +518,7 @@ public:
     /*
      * Treating tuple as a single COLUMN matrix
      */
-    tuple operator*(const tuple &rhs) const
+    constexpr tuple operator*(const tuple &rhs) const
     {
         static_assert(N == 4,
             "Our tuples are all size 4. Can only multiply 4x4 matrices.");
@@ -358,20 +532,20 @@ public:
     }
 
     template <size_t Nn>
-    friend bool operator==(const Matrix<Nn> &lhs, const Matrix<Nn> &rhs);
+    friend constexpr bool operator==(const Matrix<Nn> &lhs, const Matrix<Nn> &rhs);
 
 private:
     std::array<float, N*N> matrix_ = {};
 };
 
 template < >
-inline float Matrix<2>::determinant() const
+constexpr float Matrix<2>::determinant() const
 {
     return matrix_[0] * matrix_[3] - matrix_[1] * matrix_[2];
 }
 
 template < >
-inline float Matrix<3>::determinant() const
+constexpr float Matrix<3>::determinant() const
 {
     return
         matrix_[0] * this->cofactor(0, 0) +
@@ -379,19 +553,146 @@ inline float Matrix<3>::determinant() const
         matrix_[2] * this->cofactor(0, 2);
 }
 
+/*
+ * 4x4 determinant and inverse are written out in closed form.
+ *
+ * Splitting the matrix into top two rows and bottom two rows,
+ * every 3x3 minor is a combination of six 2x2 determinants from each half.
+ * Computing those twelve once replaces the recursive submatrix expansion.
+ */
+namespace detail
+{
+struct SubDeterminants4
+{
+    // 2x2 determinants of rows 0,1 (s) and rows 2,3 (c), over column pairs
+    float s0, s1, s2, s3, s4, s5;
+    float c0, c1, c2, c3, c4, c5;
+
+    constexpr explicit SubDeterminants4(const std::array<float, 16> &m)
+    {
+        s0 = m[0] * m[5] - m[4] * m[1];
+        s1 = m[0] * m[6] - m[4] * m[2];
+        s2 = m[0] * m[7] - m[4] * m[3];
+        s3 = m[1] * m[6] - m[5] * m[2];
+        s4 = m[1] * m[7] - m[5] * m[3];
+        s5 = m[2] * m[7] - m[6] * m[3];
+
+        c5 = m[10] * m[15] - m[14] * m[11];
+        c4 = m[9] * m[15] - m[13] * m[11];
+        c3 = m[9] * m[14] - m[13] * m[10];
+        c2 = m[8] * m[15] - m[12] * m[11];
+        c1 = m[8] * m[14] - m[12] * m[10];
+        c0 = m[8] * m[13] - m[12] * m[9];
+    }
+
+    [[nodiscard]]
+    constexpr float determinant() const
+    {
+        return s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+    }
+};
+}
+
 template < >
-inline float Matrix<4>::determinant() const
+constexpr float Matrix<4>::determinant() const
 {
-    return
-        matrix_[0] * this->cofactor(0, 0) +
-        matrix_[1] * this->cofactor(0, 1) + 
-        matrix_[2] * this->cofactor(0, 2) +
-        matrix_[3] * this->cofactor(0, 3);
+    return detail::SubDeterminants4(matrix_).determinant();
+}
+
+namespace detail
+{
+/*
+ * Inverse of an affine transform given by its top three rows, row-major (12 floats),
+ * returned the same way. Shared by Matrix<4>::affine_inverse and Affine.
+ */
+template <typename Rows>
+constexpr std::array<float, 12> affine_inverse_rows(const Rows &m)
+{
+    // inverse of the upper 3x3 through its cofactors
+    const float c00 = m[5] * m[10] - m[6] * m[9];
+    const float c01 = m[6] * m[8] - m[4] * m[10];
+    const float c02 = m[4] * m[9] - m[5] * m[8];
+
+    const float determinant = m[0] * c00 + m[1] * c01 + m[2] * c02;
+    assert(determinant != 0);
+    const float inv_det = 1.0f / determinant;
+
+    const float r00 = c00 * inv_det;
+    const float r01 = (m[2] * m[9] - m[1] * m[10]) * inv_det;
+    const float r02 = (m[1] * m[6] - m[2] * m[5]) * inv_det;
+    const float r10 = c01 * inv_det;
+    const float r11 = (m[0] * m[10] - m[2] * m[8]) * inv_det;
+    const float r12 = (m[2] * m[4] - m[0] * m[6]) * inv_det;
+    const float r20 = c02 * inv_det;
+    const float r21 = (m[1] * m[8] - m[0] * m[9]) * inv_det;
+    const float r22 = (m[0] * m[5] - m[1] * m[4]) * inv_det;
+
+    // undo the translation after undoing the linear part: -R^-1 * t
+    const float tx = m[3], ty = m[7], tz = m[11];
+
+    return std::array<float, 12> {
+        r00, r01, r02, -(r00 * tx + r01 * ty + r02 * tz),
+        r10, r11, r12, -(r10 * tx + r11 * ty + r12 * tz),
+        r20, r21, r22, -(r20 * tx + r21 * ty + r22 * tz)
+    };
+}
+}
+
+template < >
+constexpr Matrix<4> Matrix<4>::affine_inverse() const
+{
+    assert(this->is_affine());
+    const std::array<float, 12> r = detail::affine_inverse_rows(matrix_);
+
+    return Matrix<4> {
+        r[0], r[1], r[2],  r[3],
+        r[4], r[5], r[6],  r[7],
+        r[8], r[9], r[10], r[11],
+        0,    0,    0,     1
+    };
+}
+
+template < >
+constexpr Matrix<4> Matrix<4>::inverse() const
+{
+    if (this->is_affine())
+    {
+        return this->affine_inverse();
+    }
+
+    const std::array<float, 16> &m = matrix_;
+    const detail::SubDeterminants4 d(m);
+
+    const float determinant = d.determinant();
+    assert(determinant != 0);
+    const float inv_det = 1.0f / determinant;
+
+    return Matrix<4> {
+        ( m[5] * d.c5 - m[6] * d.c4 + m[7] * d.c3) * inv_det,
+        (-m[1] * d.c5 + m[2] * d.c4 - m[3] * d.c3) * inv_det,
+        ( m[13] * d.s5 - m[14] * d.s4 + m[15] * d.s3) * inv_det,
+        (-m[9] * d.s5 + m[10] * d.s4 - m[11] * d.s3) * inv_det,
+
+        (-m[4] * d.c5 + m[6] * d.c2 - m[7] * d.c1) * inv_det,
+        ( m[0] * d.c5 - m[2] * d.c2 + m[3] * d.c1) * inv_det,
+        (-m[12] * d.s5 + m[14] * d.s2 - m[15] * d.s1) * inv_det,
+        ( m[8] * d.s5 - m[10] * d.s2 + m[11] * d.s1) * inv_det,
+
+        ( m[4] * d.c4 - m[5] * d.c2 + m[7] * d.c0) * inv_det,
+        (-m[0] * d.c4 + m[1] * d.c2 - m[3] * d.c0) * inv_det,
+        ( m[12] * d.s4 - m[13] * d.s2 + m[15] * d.s0) * inv_det,
+        (-m[8] * d.s4 + m[9] * d.s2 - m[11] * d.s0) * inv_det,
+
+        (-m[4] * d.c3 + m[5] * d.c1 - m[6] * d.c0) * inv_det,
+        ( m[0] * d.c3 - m[1] * d.c1 + m[2] * d.c0) * inv_det,
+        (-m[12] * d.s3 + m[13] * d.s1 - m[14] * d.s0) * inv_det,
+        ( m[8] * d.s3 - m[9] * d.s1 + m[10] * d.s0) * inv_det
+    };
 }
 
 
 template <size_t Nn>
-bool operator==(const Matrix<Nn> &lhs, const Matrix<Nn> &rhs)
+constexpr bool operator==(const Matrix<Nn> &lhs, const Matrix<Nn> &rhs)
 {
     return std::equal(
         lhs.matrix_.begin(), lhs.matrix_.end(),
@@ -403,19 +704,99 @@ bool operator==(const Matrix<Nn> &lhs, const Matrix<Nn> &rhs)
     );
 }
 
-inline Matrix<4> identity_matrix = Matrix<4> {
+inline constexpr Matrix<4> identity_matrix = Matrix<4> {
     1, 0, 0, 0,
     0, 1, 0, 0,
     0, 0, 1, 0,
     0, 0, 0, 1
 };
 
+/*
+ * Product of two matrix expressions (a Matrix or another MatrixProduct), built by operator*.
+ * The operands are held by value, so chains of temporaries such as
+ * translation(...) * rotation_z(...) * scaling(...) stay valid after the full expression.
+ *
+ * Nothing is multiplied until the product is used, and then in the cheaper order:
+ * applied to a tuple, the factors are applied right to left, one matrix-vector product
+ * (16 multiplications) each instead of 64 for every fused pair; converted to a Matrix,
+ * the chain is fused left to right once.
+ *
+ * A chain stored to be applied again, e.g. with auto, repeats every one of its
+ * matrix-vector products for every tuple. Store it as a Matrix<4> (or a Transform)
+ * through evaluate() instead, so that each tuple costs one product.
+ */
+template <typename Lhs, typename Rhs>
+class MatrixProduct
+{
+public:
+    static constexpr size_t size = Lhs::size;
+    static_assert(Rhs::size == size, "Can only multiply matrices of the same size.");
+
+    constexpr MatrixProduct(const Lhs &lhs, const Rhs &rhs)
+        : lhs_(lhs), rhs_(rhs) {}
+
+    [[nodiscard]]
+    constexpr Matrix<size> evaluate() const
+    {
+        return lhs_.evaluate().multiply(rhs_.evaluate());
+    }
+
+    constexpr operator Matrix<size>() const
+    {
+        return this->evaluate();
+    }
+
+    [[nodiscard]]
+    constexpr Matrix<size> inverse() const
+    {
+        return this->evaluate().inverse();
+    }
+
+    [[nodiscard]]
+    constexpr tuple operator*(const tuple &rhs) const
+    {
+        return lhs_ * (rhs_ * rhs);
+    }
+
+private:
+    Lhs lhs_;
+    Rhs rhs_;
+};
+
+template <typename T>
+inline constexpr bool is_matrix_expression = false;
+template <size_t N>
+inline constexpr bool is_matrix_expression<Matrix<N>> = true;
+template <typename Lhs, typename Rhs>
+inline constexpr bool is_matrix_expression<MatrixProduct<Lhs, Rhs>> = true;
+
+template <typename Lhs, typename Rhs>
+    requires is_matrix_expression<Lhs> && is_matrix_expression<Rhs>
+[[nodiscard]]
+constexpr MatrixProduct<Lhs, Rhs> operator*(const Lhs &lhs, const Rhs &rhs)
+{
+    return MatrixProduct<Lhs, Rhs>(lhs, rhs);
+}
+
+// comparing needs the values, so products are evaluated first; Matrix == product is the rewritten form
+template <typename Lhs, typename Rhs, size_t N>
+constexpr bool operator==(const MatrixProduct<Lhs, Rhs> &lhs, const Matrix<N> &rhs)
+{
+    return lhs.evaluate() == rhs;
+}
+
+template <typename Lhs, typename Rhs, typename OtherLhs, typename OtherRhs>
+constexpr bool operator==(const MatrixProduct<Lhs, Rhs> &lhs, const MatrixProduct<OtherLhs, OtherRhs> &rhs)
+{
+    return lhs.evaluate() == rhs.evaluate();
+}
+
 /*
  * Could be neat if did not have to do multiplication by identity matrix,
  * just check Matrix.IsIdentity flag that could be set during initialization
  */
 template <size_t N>
-Matrix<N> transpose(Matrix<N> matrix)
+constexpr Matrix<N> transpose(Matrix<N> matrix)
 {
     std::array<float, N * N> tmpM = {};
     for (size_t row = 0; row < N; ++row)
@@ -429,11 +810,17 @@ Matrix<N> transpose(Matrix<N> matrix)
     return Matrix<N>(tmpM);
 }
 
+template <typename Lhs, typename Rhs>
+constexpr auto transpose(const MatrixProduct<Lhs, Rhs> &product)
+{
+    return transpose(product.evaluate());
+}
+
 }
 
 
 // ====== GEOMETRIC TRANSFORMATIONS =======
-inline rt_math::Matrix<4> translation(const float x, const float y, const float z)
+constexpr rt_math::Matrix<4> translation(const float x, const float y, const float z)
 {
     return rt_math::Matrix<4> {
         1, 0, 0, x,
@@ -443,7 +830,7 @@ inline rt_math::Matrix<4> translation(const float x, const float y, const float
     };
 }
 
-inline rt_math::Matrix<4> scaling(const float x, const float y, const float z)
+constexpr rt_math::Matrix<4> scaling(const float x, const float y, const float z)
 {
     return rt_math::Matrix<4> {
         x, 0, 0, 0,
@@ -453,7 +840,7 @@ inline rt_math::Matrix<4> scaling(const float x, const float y, const float z)
     };
 }
 
-inline rt_math::Matrix<4> reflection()
+constexpr rt_math::Matrix<4> reflection()
 {
     return rt_math::Matrix<4> {
         -1, 0, 0, 0,
@@ -463,10 +850,10 @@ inline rt_math::Matrix<4> reflection()
     };
 }
 
-inline rt_math::Matrix<4> rotation_x(const float angle)
+constexpr rt_math::Matrix<4> rotation_x(const float angle)
 {
-    const float sin = std::sin(angle);
-    const float cos = std::cos(angle);
+    const float sin = rt_math::constexpr_sin(angle);
+    const float cos = rt_math::constexpr_cos(angle);
 
     return rt_math::Matrix<4> {
         1, 0,      0, 0,
@@ -476,10 +863,10 @@ inline rt_math::Matrix<4> rotation_x(const float angle)
     };
 }
 
-inline rt_math::Matrix<4> rotation_y(const float angle)
+constexpr rt_math::Matrix<4> rotation_y(const float angle)
 {
-    const float sin = std::sin(angle);
-    const float cos = std::cos(angle);
+    const float sin = rt_math::constexpr_sin(angle);
+    const float cos = rt_math::constexpr_cos(angle);
 
     return rt_math::Matrix<4> {
         cos,  0, sin, 0,
@@ -489,10 +876,10 @@ inline rt_math::Matrix<4> rotation_y(const float angle)
     };
 }
 
-inline rt_math::Matrix<4> rotation_z(const float angle)
+constexpr rt_math::Matrix<4> rotation_z(const float angle)
 {
-    const float sin = std::sin(angle);
-    const float cos = std::cos(angle);
+    const float sin = rt_math::constexpr_sin(angle);
+    const float cos = rt_math::constexpr_cos(angle);
 
     return rt_math::Matrix<4> {
         cos, -sin, 0, 0,
@@ -502,7 +889,7 @@ inline rt_math::Matrix<4> rotation_z(const float angle)
     };
 }
 
-inline rt_math::Matrix<4> shearing(const float xy, const float xz, const float yx, const float yz, const float zx, const float zy)
+constexpr rt_math::Matrix<4> shearing(const float xy, const float xz, const float yx, const float yz, const float zx, const float zy)
 {
     return rt_math::Matrix<4> {
          1, xy, xz, 0,
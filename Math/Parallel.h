@@ -0,0 +1,110 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <exception>
+#include <thread>
+
+/*
+ * Splitting a loop over many independent elements across threads, for batch work
+ * such as transform_tuples. The calling thread takes the first chunk itself.
+ */
+namespace rt_math
+{
+
+// below this many elements per thread, starting the thread costs more than it saves
+constexpr size_t min_elements_per_thread = 16384;
+constexpr unsigned int max_chunk_threads = 64;
+
+/*
+ * How many threads for_each_chunk uses for count elements when asked for thread_count.
+ */
+[[nodiscard]]
+inline unsigned int chunk_threads(const size_t count, const unsigned int thread_count)
+{
+    return static_cast<unsigned int>(std::min<size_t>(
+        std::min(std::max(thread_count, 1u), max_chunk_threads),
+        std::max<size_t>(count / min_elements_per_thread, 1)));
+}
+
+/*
+ * Elements per chunk, a multiple of 4 so that only the last chunk has a partial SIMD step.
+ * Chunk i is [i * size, min((i + 1) * size, count)).
+ */
+[[nodiscard]]
+inline size_t chunk_size(const size_t count, const unsigned int thread_count)
+{
+    const unsigned int threads = chunk_threads(count, thread_count);
+    return ((count + threads - 1) / threads + 3) & ~size_t(3);
+}
+
+/*
+ * Runs job(begin, end) over [0, count) in chunk_threads(count, thread_count) chunks,
+ * one thread each, and returns when all are done.
+ * Every started thread is joined before this returns or throws: if a thread cannot be started
+ * or a chunk throws, the first exception is rethrown once the other chunks are done.
+ */
+template <typename Job>
+void for_each_chunk(const size_t count, const unsigned int thread_count, const Job &job)
+{
+    const unsigned int threads = chunk_threads(count, thread_count);
+    if (threads == 1)
+    {
+        job(size_t(0), count);
+        return;
+    }
+
+    // joins on the way out as well, joinable threads must not be destroyed
+    struct Workers
+    {
+        std::array<std::thread, max_chunk_threads> threads;
+        std::array<std::exception_ptr, max_chunk_threads> errors;
+
+        void join()
+        {
+            for (std::thread &thread : threads)
+            {
+                if (thread.joinable())
+                {
+                    thread.join();
+                }
+            }
+        }
+
+        ~Workers()
+        {
+            join();
+        }
+    } workers;
+
+    const size_t chunk = chunk_size(count, thread_count);
+    for (unsigned int i = 1; i < threads; ++i)
+    {
+        const size_t begin = std::min(count, chunk * i);
+        const size_t end = std::min(count, begin + chunk);
+        workers.threads[i] = std::thread([&job, &error = workers.errors[i], begin, end]
+        {
+            try
+            {
+                job(begin, end);
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+        });
+    }
+
+    job(size_t(0), std::min(count, chunk));
+
+    workers.join();
+    for (const std::exception_ptr &error : workers.errors)
+    {
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+}
@@ -0,0 +1,124 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include "Geometry.h"
+#include "Simd.h"
+
+/*
+ * Structure of arrays bundle of rays, one component per array,
+ * so every step of the intersection kernel handles several rays per instruction.
+ *
+ * Width 8 matches an AVX register. The kernel below runs it as two SSE halves,
+ * which is what every supported target has.
+ */
+struct RayPacket
+{
+    static constexpr size_t width = 8;
+
+    alignas(32) std::array<float, width> origin_x = {};
+    alignas(32) std::array<float, width> origin_y = {};
+    alignas(32) std::array<float, width> origin_z = {};
+    alignas(32) std::array<float, width> direction_x = {};
+    alignas(32) std::array<float, width> direction_y = {};
+    alignas(32) std::array<float, width> direction_z = {};
+
+    void set(const size_t lane, const Ray &ray)
+    {
+        assert(lane < width);
+
+        origin_x[lane] = ray.origin().x;
+        origin_y[lane] = ray.origin().y;
+        origin_z[lane] = ray.origin().z;
+        direction_x[lane] = ray.direction().x;
+        direction_y[lane] = ray.direction().y;
+        direction_z[lane] = ray.direction().z;
+    }
+
+    [[nodiscard]]
+    Ray ray(const size_t lane) const
+    {
+        assert(lane < width);
+
+        return Ray(
+            point(origin_x[lane], origin_y[lane], origin_z[lane]),
+            vector(direction_x[lane], direction_y[lane], direction_z[lane])
+        );
+    }
+};
+
+/*
+ * Per lane result of a packet intersection.
+ * Distances of lanes with their mask bit cleared are meaningless.
+ */
+struct PacketHits
+{
+    alignas(32) std::array<float, RayPacket::width> t0 = {};
+    alignas(32) std::array<float, RayPacket::width> t1 = {};
+    uint32_t mask = 0;
+
+    [[nodiscard]]
+    bool hit(const size_t lane) const
+    {
+        return (mask >> lane) & 1u;
+    }
+};
+
+/*
+ * Same quadratic as Sphere::intersects, for all lanes at once.
+ * Each lane's ray is moved into object space with the sphere's cached inverse,
+ * the matrix entries are broadcast across lanes.
+ */
+inline void intersects(const Sphere &sphere, const RayPacket &packet, PacketHits &hits)
+{
+    using namespace rt_math::simd;
+
+    const Affine &inv = sphere.transformation().inverse();
+    float4 m[12];
+    for (size_t row = 0; row < 3; ++row)
+    {
+        for (size_t column = 0; column < 4; ++column)
+        {
+            m[row * 4 + column] = set1(inv.at(row, column));
+        }
+    }
+
+    const float4 zero_lanes = zero();
+    const float4 two = set1(2.0f);
+    const float4 four = set1(4.0f);
+    const float4 one = set1(1.0f);
+
+    hits.mask = 0;
+    for (size_t lane = 0; lane < RayPacket::width; lane += 4)
+    {
+        const float4 wox = load(&packet.origin_x[lane]);
+        const float4 woy = load(&packet.origin_y[lane]);
+        const float4 woz = load(&packet.origin_z[lane]);
+        const float4 wdx = load(&packet.direction_x[lane]);
+        const float4 wdy = load(&packet.direction_y[lane]);
+        const float4 wdz = load(&packet.direction_z[lane]);
+
+        // origin is a point (w = 1, picks up translation), direction a vector (w = 0)
+        const float4 ox = add(add(add(mul(m[0], wox), mul(m[1], woy)), mul(m[2], woz)), m[3]);
+        const float4 oy = add(add(add(mul(m[4], wox), mul(m[5], woy)), mul(m[6], woz)), m[7]);
+        const float4 oz = add(add(add(mul(m[8], wox), mul(m[9], woy)), mul(m[10], woz)), m[11]);
+        const float4 dx = add(add(mul(m[0], wdx), mul(m[1], wdy)), mul(m[2], wdz));
+        const float4 dy = add(add(mul(m[4], wdx), mul(m[5], wdy)), mul(m[6], wdz));
+        const float4 dz = add(add(mul(m[8], wdx), mul(m[9], wdy)), mul(m[10], wdz));
+
+        // sphere at object space origin, so sphere_to_ray is the origin itself
+        const float4 a = add(add(mul(dx, dx), mul(dy, dy)), mul(dz, dz));
+        const float4 b = mul(two, add(add(mul(dx, ox), mul(dy, oy)), mul(dz, oz)));
+        const float4 c = sub(add(add(mul(ox, ox), mul(oy, oy)), mul(oz, oz)), one);
+
+        const float4 discriminant = sub(mul(b, b), mul(four, mul(a, c)));
+        hits.mask |= static_cast<uint32_t>(mask_ge(discriminant, zero_lanes)) << lane;
+
+        // clamp so missing lanes do not produce NaN
+        const float4 sqrt_discriminant = sqrt(max(discriminant, zero_lanes));
+        const float4 inv_two_a = div(one, mul(two, a));
+        const float4 minus_b = sub(zero_lanes, b);
+
+        store(&hits.t0[lane], mul(sub(minus_b, sqrt_discriminant), inv_two_a));
+        store(&hits.t1[lane], mul(add(minus_b, sqrt_discriminant), inv_two_a));
+    }
+}
@@ -0,0 +1,414 @@
+#pragma once
+
+/*
+ * Thin layer over 4 wide float registers, so tuple and color arithmetic
+ * compiles to single vector instructions.
+ *
+ * SSE2 is baseline on every x64 target (and on x86 since VS2012 default /arch:SSE2).
+ * Anything else falls back to plain loops the compiler is free to vectorize itself.
+ */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RT_MATH_SSE
+#include <emmintrin.h>
+#else
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#endif
+
+namespace rt_math::simd
+{
+
+#ifdef RT_MATH_SSE
+
+using float4 = __m128;
+
+// pointers must be 16 byte aligned
+inline float4 load(const float *p)
+{
+    return _mm_load_ps(p);
+}
+
+// any alignment, for data living in std::vector
+inline float4 loadu(const float *p)
+{
+    return _mm_loadu_ps(p);
+}
+
+inline void store(float *p, const float4 v)
+{
+    _mm_store_ps(p, v);
+}
+
+inline void storeu(float *p, const float4 v)
+{
+    _mm_storeu_ps(p, v);
+}
+
+inline float4 set1(const float a)
+{
+    return _mm_set1_ps(a);
+}
+
+// lanes in memory order
+inline float4 setr(const float a, const float b, const float c, const float d)
+{
+    return _mm_setr_ps(a, b, c, d);
+}
+
+inline float4 zero()
+{
+    return _mm_setzero_ps();
+}
+
+inline float4 add(const float4 a, const float4 b)
+{
+    return _mm_add_ps(a, b);
+}
+
+inline float4 sub(const float4 a, const float4 b)
+{
+    return _mm_sub_ps(a, b);
+}
+
+inline float4 mul(const float4 a, const float4 b)
+{
+    return _mm_mul_ps(a, b);
+}
+
+inline float4 div(const float4 a, const float4 b)
+{
+    return _mm_div_ps(a, b);
+}
+
+inline float4 sqrt(const float4 a)
+{
+    return _mm_sqrt_ps(a);
+}
+
+inline float4 max(const float4 a, const float4 b)
+{
+    return _mm_max_ps(a, b);
+}
+
+inline float4 min(const float4 a, const float4 b)
+{
+    return _mm_min_ps(a, b);
+}
+
+/*
+ * One bit per lane, lane 0 in bit 0
+ */
+inline int mask_ge(const float4 a, const float4 b)
+{
+    return _mm_movemask_ps(_mm_cmpge_ps(a, b));
+}
+
+/*
+ * Lane masks, all bits set where the comparison holds.
+ */
+inline float4 cmp_ge(const float4 a, const float4 b)
+{
+    return _mm_cmpge_ps(a, b);
+}
+
+inline float4 cmp_lt(const float4 a, const float4 b)
+{
+    return _mm_cmplt_ps(a, b);
+}
+
+inline float4 mask_and(const float4 a, const float4 b)
+{
+    return _mm_and_ps(a, b);
+}
+
+// mask ? a : b, per lane
+inline float4 select(const float4 mask, const float4 a, const float4 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+inline int movemask(const float4 mask)
+{
+    return _mm_movemask_ps(mask);
+}
+
+using int4 = __m128i;
+
+// toward zero, like static_cast<int>
+inline int4 to_int(const float4 a)
+{
+    return _mm_cvttps_epi32(a);
+}
+
+inline void store(int *p, const int4 v)
+{
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(p), v);
+}
+
+/*
+ * 16 lanes saturated to 0..255, a's lanes first, to any alignment
+ */
+inline void store_bytes(unsigned char *p, const int4 a, const int4 b, const int4 c, const int4 d)
+{
+    const __m128i bytes = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(p), bytes);
+}
+
+/*
+ * x*x + y*y + z*z, ignoring the w lane
+ */
+inline float dot3(const float4 a, const float4 b)
+{
+    const float4 product = _mm_mul_ps(a, b);
+    const float4 y = _mm_shuffle_ps(product, product, _MM_SHUFFLE(1, 1, 1, 1));
+    const float4 z = _mm_shuffle_ps(product, product, _MM_SHUFFLE(2, 2, 2, 2));
+
+    return _mm_cvtss_f32(_mm_add_ss(_mm_add_ss(product, y), z));
+}
+
+/*
+ * a.yzx * b.zxy - a.zxy * b.yzx
+ * w lane ends up as a.w * b.w - a.w * b.w, which is 0 for vectors.
+ */
+inline float4 cross3(const float4 a, const float4 b)
+{
+    const float4 a_yzx = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+    const float4 b_yzx = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+    const float4 a_zxy = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 1, 0, 2));
+    const float4 b_zxy = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 1, 0, 2));
+
+    return _mm_sub_ps(_mm_mul_ps(a_yzx, b_zxy), _mm_mul_ps(a_zxy, b_yzx));
+}
+
+// one lane of a in all four
+template <int lane>
+inline float4 splat(const float4 a)
+{
+    return _mm_shuffle_ps(a, a, _MM_SHUFFLE(lane, lane, lane, lane));
+}
+
+// rows to columns
+inline void transpose(float4 &r0, float4 &r1, float4 &r2, float4 &r3)
+{
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+}
+
+// lane i is the sum of the four lanes of ri; six shuffles, cheaper than transposing and adding
+inline float4 sum_lanes(const float4 r0, const float4 r1, const float4 r2, const float4 r3)
+{
+    const float4 s01 = _mm_add_ps(_mm_unpacklo_ps(r0, r1), _mm_unpackhi_ps(r0, r1));
+    const float4 s23 = _mm_add_ps(_mm_unpacklo_ps(r2, r3), _mm_unpackhi_ps(r2, r3));
+    return _mm_add_ps(_mm_movelh_ps(s01, s23), _mm_movehl_ps(s23, s01));
+}
+
+#else
+
+struct float4
+{
+    float v[4];
+};
+
+inline float4 load(const float *p)
+{
+    return float4{ { p[0], p[1], p[2], p[3] } };
+}
+
+inline float4 loadu(const float *p)
+{
+    return load(p);
+}
+
+inline void store(float *p, const float4 a)
+{
+    for (int i = 0; i < 4; ++i) p[i] = a.v[i];
+}
+
+inline void storeu(float *p, const float4 a)
+{
+    store(p, a);
+}
+
+inline float4 set1(const float a)
+{
+    return float4{ { a, a, a, a } };
+}
+
+inline float4 setr(const float a, const float b, const float c, const float d)
+{
+    return float4{ { a, b, c, d } };
+}
+
+inline float4 zero()
+{
+    return set1(0.0f);
+}
+
+inline float4 add(const float4 a, const float4 b)
+{
+    return float4{ { a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3] } };
+}
+
+inline float4 sub(const float4 a, const float4 b)
+{
+    return float4{ { a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3] } };
+}
+
+inline float4 mul(const float4 a, const float4 b)
+{
+    return float4{ { a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3] } };
+}
+
+inline float4 div(const float4 a, const float4 b)
+{
+    return float4{ { a.v[0] / b.v[0], a.v[1] / b.v[1], a.v[2] / b.v[2], a.v[3] / b.v[3] } };
+}
+
+inline float4 sqrt(const float4 a)
+{
+    return float4{ { std::sqrt(a.v[0]), std::sqrt(a.v[1]), std::sqrt(a.v[2]), std::sqrt(a.v[3]) } };
+}
+
+inline float4 max(const float4 a, const float4 b)
+{
+    return float4{ {
+        a.v[0] > b.v[0] ? a.v[0] : b.v[0], a.v[1] > b.v[1] ? a.v[1] : b.v[1],
+        a.v[2] > b.v[2] ? a.v[2] : b.v[2], a.v[3] > b.v[3] ? a.v[3] : b.v[3]
+    } };
+}
+
+inline float4 min(const float4 a, const float4 b)
+{
+    return float4{ {
+        a.v[0] < b.v[0] ? a.v[0] : b.v[0], a.v[1] < b.v[1] ? a.v[1] : b.v[1],
+        a.v[2] < b.v[2] ? a.v[2] : b.v[2], a.v[3] < b.v[3] ? a.v[3] : b.v[3]
+    } };
+}
+
+inline int mask_ge(const float4 a, const float4 b)
+{
+    return (a.v[0] >= b.v[0] ? 1 : 0) | (a.v[1] >= b.v[1] ? 2 : 0)
+        | (a.v[2] >= b.v[2] ? 4 : 0) | (a.v[3] >= b.v[3] ? 8 : 0);
+}
+
+namespace detail
+{
+inline float lane_mask(const bool set)
+{
+    return std::bit_cast<float>(set ? 0xFFFFFFFFu : 0u);
+}
+
+inline bool lane_set(const float mask)
+{
+    return std::bit_cast<uint32_t>(mask) != 0;
+}
+}
+
+inline float4 cmp_ge(const float4 a, const float4 b)
+{
+    float4 mask;
+    for (int i = 0; i < 4; ++i) mask.v[i] = detail::lane_mask(a.v[i] >= b.v[i]);
+    return mask;
+}
+
+inline float4 cmp_lt(const float4 a, const float4 b)
+{
+    float4 mask;
+    for (int i = 0; i < 4; ++i) mask.v[i] = detail::lane_mask(a.v[i] < b.v[i]);
+    return mask;
+}
+
+inline float4 mask_and(const float4 a, const float4 b)
+{
+    float4 mask;
+    for (int i = 0; i < 4; ++i) mask.v[i] = detail::lane_mask(detail::lane_set(a.v[i]) && detail::lane_set(b.v[i]));
+    return mask;
+}
+
+inline float4 select(const float4 mask, const float4 a, const float4 b)
+{
+    float4 result;
+    for (int i = 0; i < 4; ++i) result.v[i] = detail::lane_set(mask.v[i]) ? a.v[i] : b.v[i];
+    return result;
+}
+
+inline int movemask(const float4 mask)
+{
+    int bits = 0;
+    for (int i = 0; i < 4; ++i) bits |= detail::lane_set(mask.v[i]) ? (1 << i) : 0;
+    return bits;
+}
+
+struct int4
+{
+    int v[4];
+};
+
+inline int4 to_int(const float4 a)
+{
+    return int4{ { static_cast<int>(a.v[0]), static_cast<int>(a.v[1]), static_cast<int>(a.v[2]), static_cast<int>(a.v[3]) } };
+}
+
+inline void store(int *p, const int4 a)
+{
+    for (int i = 0; i < 4; ++i) p[i] = a.v[i];
+}
+
+inline void store_bytes(unsigned char *p, const int4 a, const int4 b, const int4 c, const int4 d)
+{
+    const int4 *lanes[4] = { &a, &b, &c, &d };
+    for (int i = 0; i < 16; ++i)
+    {
+        const int value = lanes[i / 4]->v[i % 4];
+        p[i] = static_cast<unsigned char>(value < 0 ? 0 : (value > 255 ? 255 : value));
+    }
+}
+
+inline float dot3(const float4 a, const float4 b)
+{
+    return a.v[0] * b.v[0] + a.v[1] * b.v[1] + a.v[2] * b.v[2];
+}
+
+inline float4 cross3(const float4 a, const float4 b)
+{
+    return float4{ {
+        a.v[1] * b.v[2] - a.v[2] * b.v[1],
+        a.v[2] * b.v[0] - a.v[0] * b.v[2],
+        a.v[0] * b.v[1] - a.v[1] * b.v[0],
+        0.0f
+    } };
+}
+
+template <int lane>
+inline float4 splat(const float4 a)
+{
+    return set1(a.v[lane]);
+}
+
+inline void transpose(float4 &r0, float4 &r1, float4 &r2, float4 &r3)
+{
+    float4 *rows[4] = { &r0, &r1, &r2, &r3 };
+    for (int row = 0; row < 4; ++row)
+    {
+        for (int column = row + 1; column < 4; ++column)
+        {
+            std::swap(rows[row]->v[column], rows[column]->v[row]);
+        }
+    }
+}
+
+inline float4 sum_lanes(const float4 r0, const float4 r1, const float4 r2, const float4 r3)
+{
+    const float4 *rows[4] = { &r0, &r1, &r2, &r3 };
+    float4 sums;
+    for (int row = 0; row < 4; ++row)
+    {
+        sums.v[row] = (rows[row]->v[0] + rows[row]->v[2]) + (rows[row]->v[1] + rows[row]->v[3]);
+    }
+    return sums;
+}
+
+#endif
+
+}
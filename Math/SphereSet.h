@@ -0,0 +1,167 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <limits>
+#include <vector>
+#include "Geometry.h"
+#include "Simd.h"
+
+/*
+ * Many spheres in structure of arrays form, so one ray is tested against
+ * four spheres per instruction.
+ *
+ * Spheres are unit spheres placed by their transform, so center and radius
+ * are folded into the inverse transform. Only its top three rows are stored
+ * (the bottom row of an affine inverse is always 0 0 0 1), one array per entry.
+ */
+class SphereSet
+{
+public:
+    void push_back(const Sphere &sphere)
+    {
+        const Affine &inv = sphere.transformation().inverse();
+        for (size_t entry = 0; entry < inverse_rows_.size(); ++entry)
+        {
+            inverse_rows_[entry].push_back(inv.at(entry / 4, entry % 4));
+        }
+        ++count_;
+
+        assert(count_ < (1u << 24) && "sphere indices are tracked in float lanes");
+    }
+
+    [[nodiscard]]
+    size_t size() const
+    {
+        return count_;
+    }
+
+    [[nodiscard]]
+    SphereHit closest_hit(const Ray &ray) const;
+
+private:
+    std::array<std::vector<float>, 12> inverse_rows_;
+    size_t count_ = 0;
+
+    // scalar path for the last count_ % 4 spheres
+    void closest_hit_single(const Ray &ray, size_t index, SphereHit &best) const;
+};
+
+inline void SphereSet::closest_hit_single(const Ray &ray, const size_t index, SphereHit &best) const
+{
+    const auto m = [&](const size_t entry) { return inverse_rows_[entry][index]; };
+
+    const float ox = m(0) * ray.origin().x + m(1) * ray.origin().y + m(2) * ray.origin().z + m(3);
+    const float oy = m(4) * ray.origin().x + m(5) * ray.origin().y + m(6) * ray.origin().z + m(7);
+    const float oz = m(8) * ray.origin().x + m(9) * ray.origin().y + m(10) * ray.origin().z + m(11);
+    const float dx = m(0) * ray.direction().x + m(1) * ray.direction().y + m(2) * ray.direction().z;
+    const float dy = m(4) * ray.direction().x + m(5) * ray.direction().y + m(6) * ray.direction().z;
+    const float dz = m(8) * ray.direction().x + m(9) * ray.direction().y + m(10) * ray.direction().z;
+
+    const float a = dx * dx + dy * dy + dz * dz;
+    const float b = 2 * (dx * ox + dy * oy + dz * oz);
+    const float c = ox * ox + oy * oy + oz * oz - 1;
+
+    const float discriminant = b * b - 4 * a * c;
+    if (discriminant < 0)
+    {
+        return;
+    }
+
+    const float sqrt_discriminant = std::sqrt(discriminant);
+    const float t0 = (-b - sqrt_discriminant) / (2 * a);
+    const float t1 = (-b + sqrt_discriminant) / (2 * a);
+    const float t = t0 >= 0 ? t0 : t1;
+
+    if (t >= 0 && t < best.t)
+    {
+        best.t = t;
+        best.index = index;
+    }
+}
+
+inline SphereHit SphereSet::closest_hit(const Ray &ray) const
+{
+    using namespace rt_math::simd;
+
+    const float4 wox = set1(ray.origin().x), woy = set1(ray.origin().y), woz = set1(ray.origin().z);
+    const float4 wdx = set1(ray.direction().x), wdy = set1(ray.direction().y), wdz = set1(ray.direction().z);
+
+    const float4 zero_lanes = zero();
+    const float4 one = set1(1.0f);
+    const float4 two = set1(2.0f);
+    const float4 four = set1(4.0f);
+    const float4 infinity = set1(std::numeric_limits<float>::infinity());
+    const float4 lane_offsets = setr(0, 1, 2, 3);
+
+    float4 best_t = infinity;
+    float4 best_index = set1(-1.0f);
+
+    const size_t vector_end = count_ - count_ % 4;
+    for (size_t i = 0; i < vector_end; i += 4)
+    {
+        float4 m[12];
+        for (size_t entry = 0; entry < 12; ++entry)
+        {
+            m[entry] = loadu(&inverse_rows_[entry][i]);
+        }
+
+        const float4 ox = add(add(add(mul(m[0], wox), mul(m[1], woy)), mul(m[2], woz)), m[3]);
+        const float4 oy = add(add(add(mul(m[4], wox), mul(m[5], woy)), mul(m[6], woz)), m[7]);
+        const float4 oz = add(add(add(mul(m[8], wox), mul(m[9], woy)), mul(m[10], woz)), m[11]);
+        const float4 dx = add(add(mul(m[0], wdx), mul(m[1], wdy)), mul(m[2], wdz));
+        const float4 dy = add(add(mul(m[4], wdx), mul(m[5], wdy)), mul(m[6], wdz));
+        const float4 dz = add(add(mul(m[8], wdx), mul(m[9], wdy)), mul(m[10], wdz));
+
+        const float4 a = add(add(mul(dx, dx), mul(dy, dy)), mul(dz, dz));
+        const float4 b = mul(two, add(add(mul(dx, ox), mul(dy, oy)), mul(dz, oz)));
+        const float4 c = sub(add(add(mul(ox, ox), mul(oy, oy)), mul(oz, oz)), one);
+
+        const float4 discriminant = sub(mul(b, b), mul(four, mul(a, c)));
+        const float4 hits = cmp_ge(discriminant, zero_lanes);
+        if (movemask(hits) == 0)
+        {
+            continue;
+        }
+
+        const float4 sqrt_discriminant = sqrt(max(discriminant, zero_lanes));
+        const float4 minus_b = sub(zero_lanes, b);
+        const float4 two_a = mul(two, a);
+        const float4 t0 = div(sub(minus_b, sqrt_discriminant), two_a);
+        const float4 t1 = div(add(minus_b, sqrt_discriminant), two_a);
+
+        // lowest non negative of the two, then only if it beats the best so far
+        const float4 t = select(cmp_ge(t0, zero_lanes), t0, t1);
+        const float4 better = mask_and(mask_and(hits, cmp_ge(t, zero_lanes)), cmp_lt(t, best_t));
+
+        best_t = select(better, t, best_t);
+        best_index = select(better, add(set1(static_cast<float>(i)), lane_offsets), best_index);
+    }
+
+    alignas(16) std::array<float, 4> lane_t;
+    alignas(16) std::array<float, 4> lane_index;
+    store(lane_t.data(), best_t);
+    store(lane_index.data(), best_index);
+
+    SphereHit best;
+    for (size_t lane = 0; lane < 4; ++lane)
+    {
+        if (lane_index[lane] < 0)
+        {
+            continue;
+        }
+
+        const size_t index = static_cast<size_t>(lane_index[lane]);
+        if (lane_t[lane] < best.t || (lane_t[lane] == best.t && index < best.index))
+        {
+            best.t = lane_t[lane];
+            best.index = index;
+        }
+    }
+
+    for (size_t i = vector_end; i < count_; ++i)
+    {
+        closest_hit_single(ray, i, best);
+    }
+
+    return best;
+}
@@ -0,0 +1,135 @@
+#pragma once
+#include <cstdint>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+
+/*
+ * Render statistics.
+ *
+ * Hot paths bump plain counters of the thread they run on, no atomics, no locks.
+ * A thread's counters are merged into the totals when it calls flush(), which the
+ * tile renderer does once per thread at the end of every frame. Other threads
+ * should flush once before they exit, after that they flush on exit by themselves.
+ *
+ * Defining RT_DISABLE_STATS compiles RT_STAT_ADD away entirely.
+ */
+namespace rt_math::stats
+{
+
+struct Counters
+{
+    // shader invocations of the renderers, each casts one camera ray
+    uint64_t primary_rays = 0;
+    uint64_t intersection_tests = 0;
+    uint64_t hits = 0;
+    uint64_t tiles = 0;
+    uint64_t bytes_written = 0;
+
+    Counters &operator+=(const Counters &rhs)
+    {
+        primary_rays += rhs.primary_rays;
+        intersection_tests += rhs.intersection_tests;
+        hits += rhs.hits;
+        tiles += rhs.tiles;
+        bytes_written += rhs.bytes_written;
+        return *this;
+    }
+
+    // derived rather than counted, which keeps the miss path of the tests free of bookkeeping
+    [[nodiscard]]
+    uint64_t misses() const
+    {
+        return intersection_tests - hits;
+    }
+};
+
+namespace detail
+{
+inline std::mutex mutex;
+inline Counters merged;
+
+// constant initialized and trivially destructible, so hot paths reach it with a plain thread local access
+inline constinit thread_local Counters counters{};
+
+inline void merge(Counters &thread_counters)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    merged += thread_counters;
+    thread_counters = Counters();
+}
+
+struct MergeOnExit
+{
+    ~MergeOnExit()
+    {
+        merge(counters);
+    }
+};
+}
+
+// counters of the calling thread
+inline Counters &local()
+{
+    return detail::counters;
+}
+
+/*
+ * Merges the calling thread's counters into the totals.
+ * From then on the thread also merges whatever it still counts when it exits.
+ */
+inline void flush()
+{
+    thread_local detail::MergeOnExit merge_on_exit;
+    (void)merge_on_exit;
+
+    detail::merge(local());
+}
+
+/*
+ * Totals of every thread that flushed, including the calling one.
+ * Counts other threads made since their last flush are not in yet.
+ */
+inline Counters collect()
+{
+    flush();
+    std::lock_guard<std::mutex> lock(detail::mutex);
+    return detail::merged;
+}
+
+inline void reset()
+{
+    std::lock_guard<std::mutex> lock(detail::mutex);
+    detail::merged = Counters();
+    local() = Counters();
+}
+
+inline void report(std::ostream &output, const Counters &counters)
+{
+    const auto line = [&](const char *name, const uint64_t value)
+    {
+        output << std::left << std::setw(22) << name << std::right << std::setw(16) << value << '\n';
+    };
+
+    output << "Render statistics" << '\n';
+    line("primary rays", counters.primary_rays);
+    line("intersection tests", counters.intersection_tests);
+    line("hits", counters.hits);
+    line("misses", counters.misses());
+    if (counters.intersection_tests > 0)
+    {
+        output << std::left << std::setw(22) << "hit rate" << std::right << std::setw(15) << std::fixed << std::setprecision(2)
+            << 100.0 * static_cast<double>(counters.hits) / static_cast<double>(counters.intersection_tests) << "%" << '\n';
+    }
+    line("tiles", counters.tiles);
+    line("bytes written", counters.bytes_written);
+    output.flush();
+}
+
+}
+
+#ifdef RT_DISABLE_STATS
+#define RT_STAT_ADD(counter, amount) ((void)0)
+#else
+#define RT_STAT_ADD(counter, amount) (::rt_math::stats::local().counter += (amount))
+#endif
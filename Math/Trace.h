@@ -0,0 +1,195 @@
+#pragma once
+
+/*
+ * Scoped timeline tracing, exported as Chrome trace event JSON (chrome://tracing, Perfetto).
+ *
+ * RT_TRACE_SCOPE(name) records when the enclosing scope begins and ends on the calling thread.
+ * Every thread appends to its own buffer, recording takes no lock and touches no shared data;
+ * only a thread's first event registers its buffer. write_json() reads all buffers, so call
+ * it once the traced threads are idle, after the run.
+ *
+ * Tracing only exists when RT_TRACE is defined, in every project alike so the renderer records
+ * its stages as well: the RtTrace macro of CompilerPropertySheet.props does that for the solution,
+ * e.g. msbuild raytracing.sln /p:RtTrace=true. Otherwise the macros expand to nothing.
+ * Names must be string literals, or outlive the export at least.
+ */
+#ifdef RT_TRACE
+
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace rt_math::trace
+{
+
+using Clock = std::chrono::steady_clock;
+
+struct Event
+{
+    const char *name;
+    // nanoseconds since the start of the process
+    int64_t begin;
+    int64_t end;
+};
+
+struct ThreadBuffer
+{
+    unsigned int id;
+    std::string name;
+    std::vector<Event> events;
+};
+
+namespace detail
+{
+inline const Clock::time_point start = Clock::now();
+
+inline std::mutex mutex;
+// buffers outlive their threads, their events are exported after the run
+inline std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+
+inline constinit thread_local ThreadBuffer *buffer = nullptr;
+
+inline ThreadBuffer &register_thread()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    buffers.push_back(std::make_unique<ThreadBuffer>());
+    buffer = buffers.back().get();
+    buffer->id = static_cast<unsigned int>(buffers.size());
+    buffer->events.reserve(256);
+    return *buffer;
+}
+
+inline ThreadBuffer &local()
+{
+    return buffer != nullptr ? *buffer : register_thread();
+}
+
+inline int64_t now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+}
+
+// trace event times are microseconds, the nanoseconds become the fraction
+inline void write_microseconds(std::ostream &output, const int64_t nanoseconds)
+{
+    output << nanoseconds / 1000 << '.' << std::setw(3) << std::setfill('0') << nanoseconds % 1000 << std::setfill(' ');
+}
+
+inline void write_string(std::ostream &output, const char *text)
+{
+    output << '"';
+    for (; *text != '\0'; ++text)
+    {
+        if (*text == '"' || *text == '\\')
+        {
+            output << '\\';
+        }
+        output << *text;
+    }
+    output << '"';
+}
+}
+
+// name shown for the calling thread's row of the timeline
+inline void set_thread_name(const std::string &name)
+{
+    detail::local().name = name;
+}
+
+class Scope
+{
+public:
+    explicit Scope(const char *name)
+        : name_(name), begin_(detail::now()) {}
+
+    ~Scope()
+    {
+        detail::local().events.push_back(Event{ name_, begin_, detail::now() });
+    }
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+private:
+    const char *name_;
+    int64_t begin_;
+};
+
+// events recorded so far over all threads
+[[nodiscard]]
+inline size_t event_count()
+{
+    std::lock_guard<std::mutex> lock(detail::mutex);
+    size_t count = 0;
+    for (const std::unique_ptr<ThreadBuffer> &thread : detail::buffers)
+    {
+        count += thread->events.size();
+    }
+    return count;
+}
+
+// drops all recorded events, the threads keep their buffers and names
+inline void clear()
+{
+    std::lock_guard<std::mutex> lock(detail::mutex);
+    for (const std::unique_ptr<ThreadBuffer> &thread : detail::buffers)
+    {
+        thread->events.clear();
+    }
+}
+
+/*
+ * Writes every recorded event as a complete ("X") event, timestamps in microseconds,
+ * plus the thread names as metadata events.
+ */
+inline void write_json(std::ostream &output)
+{
+    std::lock_guard<std::mutex> lock(detail::mutex);
+
+    output << "{\"traceEvents\":[";
+    const char *separator = "\n";
+    for (const std::unique_ptr<ThreadBuffer> &thread : detail::buffers)
+    {
+        if (!thread->name.empty())
+        {
+            output << separator << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread->id
+                << ",\"args\":{\"name\":";
+            detail::write_string(output, thread->name.c_str());
+            output << "}}";
+            separator = ",\n";
+        }
+
+        for (const Event &event : thread->events)
+        {
+            output << separator << "{\"name\":";
+            detail::write_string(output, event.name);
+            output << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread->id
+                << ",\"ts\":";
+            detail::write_microseconds(output, event.begin);
+            output << ",\"dur\":";
+            detail::write_microseconds(output, event.end - event.begin);
+            output << '}';
+            separator = ",\n";
+        }
+    }
+    output << "\n]}\n";
+}
+
+}
+
+#define RT_TRACE_CONCAT_(a, b) a##b
+#define RT_TRACE_CONCAT(a, b) RT_TRACE_CONCAT_(a, b)
+#define RT_TRACE_SCOPE(name) const ::rt_math::trace::Scope RT_TRACE_CONCAT(rt_trace_scope_, __LINE__)(name)
+#define RT_TRACE_THREAD_NAME(name) ::rt_math::trace::set_thread_name(name)
+
+#else
+
+#define RT_TRACE_SCOPE(name) ((void)0)
+#define RT_TRACE_THREAD_NAME(name) ((void)0)
+
+#endif
@@ -0,0 +1,94 @@
+#pragma once
+#include "Affine.h"
+#include "Math.h"
+
+namespace rt_math
+{
+
+/*
+ * Object transformation together with its inverse (for moving rays into object space).
+ * The inverse is computed once, when the transform is set, never per ray.
+ * Normals go back out through the inverse transpose, read straight from the inverse.
+ *
+ * Object transforms are affine, so both are stored as Affine, 96 bytes in all.
+ * Setting a projective matrix (bottom row other than 0 0 0 1) throws std::invalid_argument.
+ *
+ * Composing uses (A * B)^-1 = B^-1 * A^-1, so a chain of transforms
+ * does not need another inversion either.
+ */
+class Transform
+{
+public:
+    Transform() = default;
+
+    // implicit, so that translation(...) etc. can be passed wherever a Transform is expected; throws if matrix is not affine
+    Transform(const Matrix<4> &matrix)
+        : Transform(Affine(matrix)) {}
+
+    // products are lazy, fuse the chain once before inverting it
+    template <typename Lhs, typename Rhs>
+    Transform(const MatrixProduct<Lhs, Rhs> &product)
+        : Transform(product.evaluate()) {}
+
+    Transform(const Affine &matrix)
+        : matrix_(matrix), inverse_(matrix.inverse()) {}
+
+    [[nodiscard]]
+    const Affine &matrix() const
+    {
+        return matrix_;
+    }
+
+    [[nodiscard]]
+    const Affine &inverse() const
+    {
+        return inverse_;
+    }
+
+    /*
+     * Inverse transpose. Keeps normals perpendicular to surfaces under non-uniform scaling.
+     */
+    [[nodiscard]]
+    Matrix<4> normal_matrix() const
+    {
+        return transpose(static_cast<Matrix<4>>(inverse_));
+    }
+
+    /*
+     * Object space normal to world space: the transposed upper 3x3 of the inverse.
+     * The translation would only leak into w, which stays 0 to keep the result a vector.
+     */
+    [[nodiscard]]
+    tuple normal_to_world(const tuple &object_normal) const
+    {
+        const Affine &m = inverse_;
+        const tuple world_normal = vector(
+            m.at(0, 0) * object_normal.x + m.at(1, 0) * object_normal.y + m.at(2, 0) * object_normal.z,
+            m.at(0, 1) * object_normal.x + m.at(1, 1) * object_normal.y + m.at(2, 1) * object_normal.z,
+            m.at(0, 2) * object_normal.x + m.at(1, 2) * object_normal.y + m.at(2, 2) * object_normal.z
+        );
+
+        return normalize(world_normal);
+    }
+
+    Transform operator*(const Transform &rhs) const
+    {
+        return Transform(matrix_ * rhs.matrix_, rhs.inverse_ * inverse_);
+    }
+
+    tuple operator*(const tuple &rhs) const
+    {
+        return matrix_ * rhs;
+    }
+
+private:
+    Transform(const Affine &matrix, const Affine &inverse)
+        : matrix_(matrix), inverse_(inverse) {}
+
+    Affine matrix_;
+    Affine inverse_;
+};
+
+static_assert(sizeof(Transform) == 2 * sizeof(Affine), "Transform holds the matrix and its inverse only");
+
+}
@@ -1,41 +1,133 @@
 #include "pch.h"
 #include "Canvas.h"
+#include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <type_traits>
 
 #include <iostream>
 
 
-Canvas::Canvas(unsigned int const width, unsigned int const height) : width(width), height(height)
+Canvas::Canvas(unsigned int const width, unsigned int const height, const CanvasLayout layout, const PixelFormat format)
+	: grid_((storage_size(width, height, layout) * pixel_format::bytes_per_pixel(format) + sizeof(rt_math::color) - 1) / sizeof(rt_math::color), rt_math::color(0, 0, 0)),
+	  pixels_(reinterpret_cast<unsigned char*>(this->grid_.data())), layout_(layout), format_(format), tiles_x_((width + tile_size - 1) / tile_size),
+	  grid_size_(storage_size(width, height, layout)), width(width), height(height)
 {
-	unsigned int const grid_size = width * height;
-	this->grid_.reserve(grid_size);
+}
+
+// all zero bytes are black in every format, which is what a freshly sized file reads as, so nothing to fill
+Canvas::Canvas(unsigned int const width, unsigned int const height, const std::string& backingFileName, const CanvasLayout layout, const PixelFormat format)
+	: mapping_(new MappedFile(backingFileName, storage_size(width, height, layout) * pixel_format::bytes_per_pixel(format))),
+	  pixels_(static_cast<unsigned char*>(this->mapping_->data())), layout_(layout), format_(format), tiles_x_((width + tile_size - 1) / tile_size),
+	  grid_size_(storage_size(width, height, layout)), width(width), height(height)
+{
+	static_assert(std::is_trivially_copyable_v<rt_math::color>, "pixels are read straight from the mapped bytes");
+}
+
+// tiled canvases are padded up to whole tiles
+size_t Canvas::storage_size(unsigned int const width, unsigned int const height, const CanvasLayout layout)
+{
+	if (layout == CanvasLayout::RowMajor)
+	{
+		return static_cast<size_t>(width) * height;
+	}
+
+	const size_t tiles_x = (width + tile_size - 1) / tile_size;
+	const size_t tiles_y = (height + tile_size - 1) / tile_size;
+	return tiles_x * tiles_y * tile_size * tile_size;
+}
+
+size_t Canvas::offset(unsigned int const x, unsigned int const y) const
+{
+	if (this->layout_ == CanvasLayout::RowMajor)
+	{
+		return static_cast<size_t>(this->width) * y + x;
+	}
+
+	// interleave the low 3 bits of x and y: x0 y0 x1 y1 x2 y2
+	static constexpr unsigned char spread[tile_size] = { 0, 1, 4, 5, 16, 17, 20, 21 };
+	const size_t tile = static_cast<size_t>(y / tile_size) * this->tiles_x_ + x / tile_size;
+	return tile * tile_size * tile_size + (spread[x % tile_size] | (spread[y % tile_size] << 1));
+}
+
+rt_math::color Canvas::load(size_t const index) const
+{
+	switch (this->format_)
+	{
+		case PixelFormat::Half:
+		{
+			uint16_t half[3];
+			std::memcpy(half, this->pixels_ + index * sizeof(half), sizeof(half));
+			return rt_math::color(pixel_format::half_to_float(half[0]), pixel_format::half_to_float(half[1]), pixel_format::half_to_float(half[2]));
+		}
+		case PixelFormat::Rgba8:
+		{
+			const unsigned char* rgba = this->pixels_ + index * 4;
+			return rt_math::color(pixel_format::byte_to_float(rgba[0]), pixel_format::byte_to_float(rgba[1]), pixel_format::byte_to_float(rgba[2]));
+		}
+		default:
+			return reinterpret_cast<const rt_math::color*>(this->pixels_)[index];
+	}
+}
 
-	for (unsigned int i = 0; i < grid_size; ++i)
+void Canvas::store(size_t const index, const rt_math::color& color)
+{
+	switch (this->format_)
 	{
-		this->grid_.push_back(rt_math::color(0, 0, 0));
+		case PixelFormat::Half:
+		{
+			const uint16_t half[3] = {
+				pixel_format::float_to_half(color.red),
+				pixel_format::float_to_half(color.green),
+				pixel_format::float_to_half(color.blue)
+			};
+			std::memcpy(this->pixels_ + index * sizeof(half), half, sizeof(half));
+			break;
+		}
+		case PixelFormat::Rgba8:
+		{
+			unsigned char* rgba = this->pixels_ + index * 4;
+			rgba[0] = pixel_format::float_to_byte(color.red);
+			rgba[1] = pixel_format::float_to_byte(color.green);
+			rgba[2] = pixel_format::float_to_byte(color.blue);
+			rgba[3] = 255;
+			break;
+		}
+		default:
+			reinterpret_cast<rt_math::color*>(this->pixels_)[index] = color;
 	}
-	this->grid_size_ = grid_size;
 }
 
 rt_math::color Canvas::pixel_at(unsigned int const x, unsigned int const y) const
 {
-	unsigned int const offset = this->width * y + x;
-	assert(offset < this->grid_size_);
+	assert(x < this->width && y < this->height);
 
-	return this->grid_[offset];
+	return this->load(this->offset(x, y));
 }
 
 void Canvas::write_pixel(unsigned const int x, unsigned const int y, const rt_math::color color)
 {
-	unsigned int const offset = this->width * y + x;
-
-	if (offset > this->grid_size_) {
+	if (x >= this->width || y >= this->height) {
 		std::cout << "Writing pixel (" << x << ", " << y << ") outside of canvas dimensions " << this->width << "x" << this->height << std::endl;
 
 	    return;
 	}
 
-	this->grid_[offset] = color;
+	this->store(this->offset(x, y), color);
+}
+
+void Canvas::write_block(unsigned int const x0, unsigned int const y0, unsigned int const w, unsigned int const h, const rt_math::color* pixels)
+{
+	const unsigned int x1 = std::min(x0 + w, this->width);
+	const unsigned int y1 = std::min(y0 + h, this->height);
+	for (unsigned int y = y0; y < y1; ++y)
+	{
+		const rt_math::color* row = pixels + static_cast<size_t>(y - y0) * w;
+		for (unsigned int x = x0; x < x1; ++x)
+		{
+			this->store(this->offset(x, y), row[x - x0]);
+		}
+	}
 }
 
 // void Canvas::write_pixel(float const x, float const y, const rt_math::color color)
@@ -43,7 +135,59 @@ void Canvas::write_pixel(unsigned const int x, unsigned const int y, const rt_ma
 // 	this->write_pixel(static_cast<unsigned int>(x), static_cast<unsigned int> (y), color);
 // }
 
-std::vector<rt_math::color>::const_iterator Canvas::canvas_iterator() const
+const rt_math::color* Canvas::storage_data() const
+{
+	assert(this->format_ == PixelFormat::Float32);
+
+	return reinterpret_cast<const rt_math::color*>(this->pixels_);
+}
+
+void Canvas::advise_sequential() const
 {
-	return this->grid_.begin();
+	if (this->mapping_ != nullptr)
+	{
+		this->mapping_->advise_sequential();
+	}
+}
+
+const rt_math::color* Canvas::read_rows(unsigned int const y0, unsigned int const rows, std::vector<rt_math::color>& scratch) const
+{
+	assert(y0 + rows <= this->height);
+
+	if (this->layout_ == CanvasLayout::RowMajor && this->format_ == PixelFormat::Float32)
+	{
+		return reinterpret_cast<const rt_math::color*>(this->pixels_) + static_cast<size_t>(this->width) * y0;
+	}
+
+	scratch.resize(static_cast<size_t>(this->width) * rows);
+	if (this->layout_ == CanvasLayout::RowMajor)
+	{
+		const size_t first = static_cast<size_t>(this->width) * y0;
+		for (size_t i = 0; i < scratch.size(); ++i)
+		{
+			scratch[i] = this->load(first + i);
+		}
+		return scratch.data();
+	}
+
+	constexpr unsigned int tile_pixels = tile_size * tile_size;
+	const unsigned int y1 = y0 + rows;
+	for (unsigned int tile_y = y0 - y0 % tile_size; tile_y < y1; tile_y += tile_size)
+	{
+		size_t tile = static_cast<size_t>(tile_y / tile_size) * this->tiles_x_ * tile_pixels;
+		for (unsigned int tile_x = 0; tile_x < this->width; tile_x += tile_size, tile += tile_pixels)
+		{
+			for (unsigned int i = 0; i < tile_pixels; ++i)
+			{
+				const unsigned int x = tile_x + morton_x(i);
+				const unsigned int y = tile_y + morton_y(i);
+				if (x < this->width && y >= y0 && y < y1)
+				{
+					scratch[static_cast<size_t>(y - y0) * this->width + x] = this->load(tile + i);
+				}
+			}
+		}
+	}
+
+	return scratch.data();
 }
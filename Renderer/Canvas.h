@@ -1,22 +1,165 @@
 #pragma once
 #include "../Math/Math.h"
 #include <memory>
+#include <string>
 #include <vector>
 
+#include "MappedFile.h"
+#include "PixelFormat.h"
+
+/*
+ * RowMajor: width * y + x, what the writers want.
+ * Tiled: 8x8 pixel tiles stored one after another, pixels inside a tile in Morton (Z) order,
+ * so every 2x2 block is one 64 byte cache line and every tile 1 KiB.
+ * Neighbourhoods then stay within a few lines instead of spanning rows far apart.
+ */
+enum class CanvasLayout
+{
+	RowMajor,
+	Tiled
+};
+
 class Canvas
 {
 	private:
 		
+		// in whole colors so Float32 pixels are aligned, compact formats use it as bytes
 		std::vector<rt_math::color> grid_;
-		unsigned int grid_size_;
+		std::unique_ptr<MappedFile> mapping_;
+		// points into grid_ or mapping_, whichever holds the pixels
+		unsigned char* pixels_;
+		CanvasLayout layout_;
+		PixelFormat format_;
+		unsigned int tiles_x_;
+		size_t grid_size_;
+
+		[[nodiscard]] size_t offset(unsigned int x, unsigned int y) const;
+		[[nodiscard]] static size_t storage_size(unsigned int width, unsigned int height, CanvasLayout layout);
+
+		// pixel at storage index, decoded from / encoded to format_
+		[[nodiscard]] rt_math::color load(size_t index) const;
+		void store(size_t index, const rt_math::color& color);
 
 	public:
 
+		static constexpr unsigned int tile_size = 8;
+
 		unsigned int const width, height;
-		Canvas(unsigned int width, unsigned int height);
+		/*
+		 * Compact formats (see PixelFormat) cut frame memory to 6 or 4 bytes per pixel,
+		 * pixel_at still returns an rt_math::color.
+		 */
+		Canvas(unsigned int width, unsigned int height, CanvasLayout layout = CanvasLayout::RowMajor, PixelFormat format = PixelFormat::Float32);
+		/*
+		 * Out of core canvas: pixels live in backingFileName, mapped into memory and paged in
+		 * by the OS as they are touched, so the canvas can be larger than RAM.
+		 * The file is overwritten and kept after the canvas is gone.
+		 */
+		Canvas(unsigned int width, unsigned int height, const std::string& backingFileName, CanvasLayout layout = CanvasLayout::RowMajor, PixelFormat format = PixelFormat::Float32);
+
+		Canvas(const Canvas&) = delete;
+		Canvas& operator=(const Canvas&) = delete;
+		Canvas(Canvas&&) noexcept = default;
+
         [[nodiscard]] rt_math::color pixel_at(unsigned int const x, unsigned int const y) const;
 		void write_pixel(unsigned int const x, unsigned int const y, const rt_math::color color);
 		// void write_pixel(float const x, float const y, const rt_math::color color);
-        [[nodiscard]] std::vector<rt_math::color>::const_iterator canvas_iterator() const;
+		/*
+		 * Writes a w x h block of pixels at (x0, y0), row major in pixels, clipped to the canvas.
+		 * Lets renderers shade a tile in floats and convert it to the storage format in one go.
+		 */
+		void write_block(unsigned int x0, unsigned int y0, unsigned int w, unsigned int h, const rt_math::color* pixels);
+		/*
+		 * The raw pixels in storage order, PixelFormat::Float32 only. That is row major only for
+		 * CanvasLayout::RowMajor; code that wants rows on any canvas reads them through read_rows.
+		 */
+		[[nodiscard]] const rt_math::color* storage_data() const;
+		[[nodiscard]] CanvasLayout layout() const { return this->layout_; }
+		[[nodiscard]] PixelFormat pixel_format() const { return this->format_; }
+		[[nodiscard]] size_t storage_bytes() const { return this->grid_size_ * pixel_format::bytes_per_pixel(this->format_); }
+		[[nodiscard]] bool is_mapped() const { return this->mapping_ != nullptr; }
+		// hint before reading the whole canvas front to back, e.g. to write it out
+		void advise_sequential() const;
+
+		/*
+		 * rows full rows starting at y0, row major. A row major Float32 canvas returns its own pixels,
+		 * any other gathers and decodes them into scratch, a tiled one a tile at a time. Bands starting on a multiple
+		 * of tile_size read every tile they touch only once.
+		 */
+		[[nodiscard]] const rt_math::color* read_rows(unsigned int y0, unsigned int rows, std::vector<rt_math::color>& scratch) const;
+
+		/*
+		 * Calls visit(x, y, color) for every pixel, in the order they are stored,
+		 * so whole cache lines are used before moving on.
+		 */
+		template <typename Visitor>
+		void for_each_pixel(Visitor&& visit) const
+		{
+			this->walk_storage([this, &visit](const unsigned int x, const unsigned int y, const size_t index)
+			{
+				const rt_math::color pixel = this->load(index);
+				visit(x, y, pixel);
+			});
+		}
+
+		// same, visit gets a mutable reference to update pixels in place
+		template <typename Visitor>
+		void for_each_pixel(Visitor&& visit)
+		{
+			this->walk_storage([this, &visit](const unsigned int x, const unsigned int y, const size_t index)
+			{
+				if (this->format_ == PixelFormat::Float32)
+				{
+					visit(x, y, reinterpret_cast<rt_math::color*>(this->pixels_)[index]);
+					return;
+				}
+
+				rt_math::color pixel = this->load(index);
+				visit(x, y, pixel);
+				this->store(index, pixel);
+			});
+		}
+
+	private:
+
+		// x and y of the pixel at index (0..63) inside a tile
+		static unsigned int morton_x(unsigned int index) { return (index & 1) | ((index >> 1) & 2) | ((index >> 2) & 4); }
+		static unsigned int morton_y(unsigned int index) { return morton_x(index >> 1); }
+
+		// visit(x, y, storage index) in storage order
+		template <typename Visitor>
+		void walk_storage(const Visitor& visit) const
+		{
+			size_t index = 0;
+			if (this->layout_ == CanvasLayout::RowMajor)
+			{
+				for (unsigned int y = 0; y < this->height; ++y)
+				{
+					for (unsigned int x = 0; x < this->width; ++x)
+					{
+						visit(x, y, index++);
+					}
+				}
+				return;
+			}
+
+			constexpr unsigned int tile_pixels = tile_size * tile_size;
+			for (unsigned int tile_y = 0; tile_y < this->height; tile_y += tile_size)
+			{
+				for (unsigned int tile_x = 0; tile_x < this->width; tile_x += tile_size, index += tile_pixels)
+				{
+					for (unsigned int i = 0; i < tile_pixels; ++i)
+					{
+						const unsigned int x = tile_x + morton_x(i);
+						const unsigned int y = tile_y + morton_y(i);
+						// edge tiles are padded
+						if (x < this->width && y < this->height)
+						{
+							visit(x, y, index + i);
+						}
+					}
+				}
+			}
+		}
 };
 
@@ -0,0 +1,99 @@
+#include "pch.h"
+#include "MappedFile.h"
+
+#include <system_error>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& fileName, size_t const size) : size_(size)
+{
+	HANDLE const file = CreateFileA(fileName.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), "CreateFile " + fileName);
+	}
+	this->file_ = file;
+
+	// sizing the mapping grows the file, the new part reads as zeroes
+	const auto size64 = static_cast<unsigned long long>(size);
+	HANDLE const mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, static_cast<DWORD>(size64 >> 32), static_cast<DWORD>(size64), nullptr);
+	if (mapping == nullptr)
+	{
+		const DWORD error = GetLastError();
+		CloseHandle(file);
+		throw std::system_error(static_cast<int>(error), std::system_category(), "CreateFileMapping " + fileName);
+	}
+	this->mapping_ = mapping;
+
+	this->data_ = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+	if (this->data_ == nullptr)
+	{
+		const DWORD error = GetLastError();
+		CloseHandle(mapping);
+		CloseHandle(file);
+		throw std::system_error(static_cast<int>(error), std::system_category(), "MapViewOfFile " + fileName);
+	}
+}
+
+MappedFile::~MappedFile()
+{
+	UnmapViewOfFile(this->data_);
+	CloseHandle(this->mapping_);
+	CloseHandle(this->file_);
+}
+
+void MappedFile::advise_sequential() const
+{
+	// PrefetchVirtualMemory would be the equivalent, the default read ahead is good enough here
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& fileName, size_t const size) : size_(size)
+{
+	this->file_ = open(fileName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (this->file_ < 0)
+	{
+		throw std::system_error(errno, std::generic_category(), "open " + fileName);
+	}
+
+	// truncating to zero first makes the whole file a hole that reads as zeroes
+	if (ftruncate(this->file_, static_cast<off_t>(size)) != 0)
+	{
+		const int error = errno;
+		close(this->file_);
+		throw std::system_error(error, std::generic_category(), "ftruncate " + fileName);
+	}
+
+	// mmap refuses zero length
+	void* const data = mmap(nullptr, size > 0 ? size : 1, PROT_READ | PROT_WRITE, MAP_SHARED, this->file_, 0);
+	if (data == MAP_FAILED)
+	{
+		const int error = errno;
+		close(this->file_);
+		throw std::system_error(error, std::generic_category(), "mmap " + fileName);
+	}
+	this->data_ = data;
+}
+
+MappedFile::~MappedFile()
+{
+	munmap(this->data_, this->size_ > 0 ? this->size_ : 1);
+	close(this->file_);
+}
+
+void MappedFile::advise_sequential() const
+{
+	madvise(this->data_, this->size_, MADV_SEQUENTIAL);
+}
+
+#endif
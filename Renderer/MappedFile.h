@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/*
+ * Read/write mapping of a whole file, created (or truncated) to the requested size.
+ * New files read as zeroes. Pages are loaded by the OS on first touch and written back
+ * by it under memory pressure and on unmap, so the file can be much larger than RAM.
+ *
+ * Throws std::system_error if the file cannot be created or mapped.
+ */
+class MappedFile
+{
+	public:
+
+		MappedFile(const std::string& fileName, size_t size);
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		[[nodiscard]] void* data() const { return this->data_; }
+		[[nodiscard]] size_t size() const { return this->size_; }
+
+		// tells the OS the range will be read front to back, so it can read ahead
+		void advise_sequential() const;
+
+	private:
+
+		void* data_ = nullptr;
+		size_t size_ = 0;
+
+#ifdef _WIN32
+		void* file_ = nullptr;
+		void* mapping_ = nullptr;
+#else
+		int file_ = -1;
+#endif
+};
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include "../Math/Math.h"
+
+/*
+ * How a Canvas stores each pixel.
+ * Float32: rt_math::color as is, 16 bytes with padding. Exact.
+ * Half:    three IEEE half floats, 6 bytes. 11 significant bits, range up to 65504, keeps HDR values.
+ * Rgba8:   one byte per channel plus an opaque alpha, 4 bytes. Clamped to 0..1 and rounded
+ *          the same way the PPM writers round, so LDR output is unchanged.
+ */
+enum class PixelFormat
+{
+	Float32,
+	Half,
+	Rgba8
+};
+
+namespace pixel_format
+{
+	[[nodiscard]] inline size_t bytes_per_pixel(const PixelFormat format)
+	{
+		switch (format)
+		{
+			case PixelFormat::Half: return 3 * sizeof(uint16_t);
+			case PixelFormat::Rgba8: return 4;
+			default: return sizeof(rt_math::color);
+		}
+	}
+
+	// round to nearest even, overflow to infinity, NaN stays NaN
+	[[nodiscard]] inline uint16_t float_to_half(const float value)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+
+		const uint32_t sign = (bits >> 16) & 0x8000u;
+		const uint32_t exponent = (bits >> 23) & 0xFFu;
+		uint32_t mantissa = bits & 0x7FFFFFu;
+
+		if (exponent == 0xFF)
+		{
+			return static_cast<uint16_t>(sign | 0x7C00u | (mantissa != 0 ? 0x200u : 0));
+		}
+
+		const int half_exponent = static_cast<int>(exponent) - 127 + 15;
+		if (half_exponent >= 0x1F)
+		{
+			return static_cast<uint16_t>(sign | 0x7C00u);
+		}
+
+		if (half_exponent <= 0)
+		{
+			// subnormal half, or zero
+			if (half_exponent < -10)
+			{
+				return static_cast<uint16_t>(sign);
+			}
+			mantissa |= 0x800000u;
+			const unsigned int shift = static_cast<unsigned int>(14 - half_exponent);
+			uint32_t half_mantissa = mantissa >> shift;
+			const uint32_t remainder = mantissa & ((1u << shift) - 1);
+			const uint32_t halfway = 1u << (shift - 1);
+			if (remainder > halfway || (remainder == halfway && (half_mantissa & 1)))
+			{
+				++half_mantissa;
+			}
+			return static_cast<uint16_t>(sign | half_mantissa);
+		}
+
+		uint32_t half = sign | (static_cast<uint32_t>(half_exponent) << 10) | (mantissa >> 13);
+		const uint32_t remainder = mantissa & 0x1FFFu;
+		if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1)))
+		{
+			// a carry out of the mantissa bumps the exponent, up to infinity, which is correct
+			++half;
+		}
+		return static_cast<uint16_t>(half);
+	}
+
+	[[nodiscard]] inline float half_to_float(const uint16_t half)
+	{
+		const uint32_t sign = static_cast<uint32_t>(half & 0x8000u) << 16;
+		const uint32_t exponent = (half >> 10) & 0x1Fu;
+		uint32_t mantissa = half & 0x3FFu;
+
+		uint32_t bits;
+		if (exponent == 0x1F)
+		{
+			bits = sign | 0x7F800000u | (mantissa << 13);
+		}
+		else if (exponent != 0)
+		{
+			bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+		}
+		else if (mantissa == 0)
+		{
+			bits = sign;
+		}
+		else
+		{
+			// subnormal half, normalize it
+			int e = 1;
+			while ((mantissa & 0x400u) == 0)
+			{
+				mantissa <<= 1;
+				--e;
+			}
+			bits = sign | (static_cast<uint32_t>(e + 127 - 15) << 23) | ((mantissa & 0x3FFu) << 13);
+		}
+
+		float value;
+		std::memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	// 0..1 to 0..255, out of range values clamped; rounds like Quantizer does
+	[[nodiscard]] inline uint8_t float_to_byte(const float channel)
+	{
+		const float clamped = channel > 0 ? (channel < 1 ? channel : 1) : 0;
+		return static_cast<uint8_t>(clamped * 255.0f + 0.5f);
+	}
+
+	[[nodiscard]] inline float byte_to_float(const uint8_t channel)
+	{
+		return static_cast<float>(channel) * (1.0f / 255.0f);
+	}
+}
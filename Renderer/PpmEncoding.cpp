@@ -0,0 +1,65 @@
+#include "pch.h"
+#include "PpmEncoding.h"
+
+void ppm::write_header(std::ostream& output, const PpmFormat format, unsigned int const width, unsigned int const height)
+{
+	output
+		<< (format == PpmFormat::P6 ? "P6" : "P3") << '\n'
+		<< width << " " << height << '\n'
+		<< "255" << '\n';
+}
+
+/*
+ * '\n' rather than std::endl, the stream is flushed once when closed.
+ */
+void ppm::write_p3_row(std::ostream& output, const unsigned char* row, unsigned int const width)
+{
+	const unsigned int last_coll_offset = width - 1;
+	unsigned int char_counter = 0;
+	for (unsigned int x = 0; x < width; ++x)
+	{
+		const unsigned int red   = row[x * 3];
+		const unsigned int green = row[x * 3 + 1];
+		const unsigned int blue  = row[x * 3 + 2];
+
+		output << red;
+		char_counter = char_counter + 3;
+		if (char_counter + 7 > 70)
+		{
+			output << '\n';
+			char_counter = 0;
+		} else
+		{
+			output << " ";
+			char_counter = char_counter + 1;
+		}
+
+
+		output << green;
+		char_counter = char_counter + 3;
+		if (char_counter + 7 > 70)
+		{
+			output << '\n';
+			char_counter = 0;
+		}
+		else
+		{
+			output << " ";
+			char_counter = char_counter + 1;
+		}
+
+
+		output << blue;
+		char_counter = char_counter + 3;
+		if (x == last_coll_offset || (char_counter + 7 > 70))
+		{
+			output << '\n';
+			char_counter = 0;
+		}
+		else
+		{
+			output << " ";
+			char_counter = char_counter + 1;
+		}
+	}
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <ostream>
+
+/*
+ * P3 is plain text, one number per channel. Readable, but large and slow to write.
+ * P6 stores the same header followed by raw bytes, three per pixel.
+ */
+enum class PpmFormat
+{
+	P3,
+	P6
+};
+
+/*
+ * Pieces of a PPM file shared by the whole-canvas and the streaming writers.
+ * Pixels are quantized beforehand by a Quantizer.
+ * Rows are independent of each other in both formats, so a file can be produced one row at a time.
+ */
+namespace ppm
+{
+	void write_header(std::ostream& output, PpmFormat format, unsigned int width, unsigned int height);
+
+	// one row already quantized to 3 bytes per pixel, split so no line is longer than 70 characters
+	void write_p3_row(std::ostream& output, const unsigned char* row, unsigned int width);
+}
@@ -0,0 +1,67 @@
+#include "pch.h"
+#include "PpmStreamWriter.h"
+#include "../Math/Stats.h"
+#include "../Math/Trace.h"
+
+#include <cassert>
+
+PpmStreamWriter::PpmStreamWriter(const std::string& outputFileName, unsigned int const width, unsigned int const height, const PpmFormat format, const ToneMapping& mapping)
+	// binary for P6, otherwise Windows turns every 0x0A byte into 0x0D 0x0A
+	: output_(outputFileName, format == PpmFormat::P6 ? std::ios::out | std::ios::binary : std::ios::out),
+	  format_(format), quantizer_(mapping), width(width), height(height)
+{
+	ppm::write_header(this->output_, this->format_, width, height);
+	this->count_written_bytes();
+}
+
+void PpmStreamWriter::write_row(const rt_math::color* row)
+{
+	this->write_pixels(row, 1);
+}
+
+void PpmStreamWriter::write_rows(const Canvas& band, unsigned int const rows)
+{
+	assert(band.width == this->width && rows <= band.height);
+
+	this->write_pixels(band.read_rows(0, rows, this->scratch_), rows);
+}
+
+// P6 goes out in one write per call
+void PpmStreamWriter::write_pixels(const rt_math::color* pixels, unsigned int const rows)
+{
+	RT_TRACE_SCOPE("PpmStreamWriter::write_pixels");
+	assert(this->rows_written_ + rows <= this->height);
+
+	const size_t row_bytes = static_cast<size_t>(this->width) * 3;
+	this->bytes_.resize(row_bytes * rows);
+	this->quantizer_.to_rgb8(pixels, static_cast<size_t>(this->width) * rows, this->bytes_.data());
+
+	if (this->format_ == PpmFormat::P6)
+	{
+		this->output_.write(reinterpret_cast<const char*>(this->bytes_.data()), static_cast<std::streamsize>(this->bytes_.size()));
+	}
+	else
+	{
+		for (unsigned int y = 0; y < rows; ++y)
+		{
+			ppm::write_p3_row(this->output_, this->bytes_.data() + y * row_bytes, this->width);
+		}
+	}
+
+	this->count_written_bytes();
+	this->rows_written_ += rows;
+	if (this->complete())
+	{
+		this->output_.flush();
+	}
+}
+
+void PpmStreamWriter::count_written_bytes()
+{
+	const std::streamoff position = this->output_.tellp();
+	if (position > this->bytes_counted_)
+	{
+		RT_STAT_ADD(bytes_written, static_cast<uint64_t>(position - this->bytes_counted_));
+		this->bytes_counted_ = position;
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "Canvas.h"
+#include "PpmEncoding.h"
+#include "Quantizer.h"
+
+/*
+ * Writes a PPM file a few rows at a time, top to bottom, while the rest of the image
+ * is still being rendered. Only the rows handed in need to exist in memory.
+ *
+ * Header goes out on construction, the file is complete once all height rows are written.
+ */
+class PpmStreamWriter
+{
+
+private:
+	std::ofstream output_;
+	PpmFormat format_;
+	Quantizer quantizer_;
+	unsigned int rows_written_ = 0;
+	std::vector<unsigned char> bytes_;
+	// row major copy of a tiled band
+	std::vector<rt_math::color> scratch_;
+	// stream position already added to the bytes_written statistic
+	std::streamoff bytes_counted_ = 0;
+
+	void write_pixels(const rt_math::color* pixels, unsigned int rows);
+	void count_written_bytes();
+
+public:
+	unsigned int const width, height;
+
+	PpmStreamWriter(const std::string& outputFileName, unsigned int width, unsigned int height, PpmFormat format = PpmFormat::P6, const ToneMapping& mapping = ToneMapping());
+
+	// width pixels of the next row
+	void write_row(const rt_math::color* row);
+	// first rows of band, which must be as wide as the image
+	void write_rows(const Canvas& band, unsigned int rows);
+
+	[[nodiscard]] unsigned int rows_written() const { return this->rows_written_; }
+	[[nodiscard]] bool complete() const { return this->rows_written_ == this->height; }
+};
@@ -1,76 +1,89 @@
 #include "pch.h"
 #include "PpmWriter.h"
+#include "../Math/Stats.h"
+#include "../Math/Trace.h"
 
+#include <algorithm>
 #include <fstream>
+#include <vector>
+
+namespace
+{
+	// what the stream holds so far, 0 if it failed
+	uint64_t written_bytes(std::ostream& output)
+	{
+		const std::streamoff position = output.tellp();
+		return position > 0 ? static_cast<uint64_t>(position) : 0;
+	}
+}
 
 void PpmWriter::canvas_to_ppm(const Canvas* canvas) const
 {
-	std::ofstream output(this->outputFileName_);
+	RT_TRACE_SCOPE("PpmWriter::canvas_to_ppm");
+	if (this->format_ == PpmFormat::P6)
+	{
+		this->write_p6(canvas);
+	}
+	else
+	{
+		this->write_p3(canvas);
+	}
+}
 
-	// if(output.is_open())
-	// {
-	output
-		<< "P3" << std::endl
-		<< canvas->width << " " << canvas->height << std::endl
-		<< "255" << std::endl;
+/*
+ * Quantizes a band of rows at a time into one buffer, each band handed to the stream in a single write.
+ * Bounding the buffer keeps out of core canvases from being copied into memory whole.
+ */
+void PpmWriter::write_p6(const Canvas* canvas) const
+{
+	constexpr size_t band_bytes = 1 << 20;
+	const size_t row_bytes = static_cast<size_t>(canvas->width) * 3;
+	// whole tile rows, so a tiled canvas is gathered one tile at a time
+	const unsigned int band_rows = static_cast<unsigned int>(std::max<size_t>(1, band_bytes / std::max<size_t>(1, row_bytes * Canvas::tile_size))) * Canvas::tile_size;
+	std::vector<unsigned char> bytes(std::min(band_rows, canvas->height) * row_bytes);
+	std::vector<rt_math::color> scratch;
 
-	std::vector<rt_math::color>::const_iterator it = canvas->canvas_iterator();
+	// binary, otherwise Windows turns every 0x0A byte into 0x0D 0x0A
+	std::ofstream output(this->outputFileName_, std::ios::binary);
+	ppm::write_header(output, PpmFormat::P6, canvas->width, canvas->height);
 
-	const unsigned int last_coll_offset = canvas->width - 1;
-	unsigned int char_counter = 0;
-	for(unsigned int y = 0; y < canvas->height; ++y)
+	canvas->advise_sequential();
+	for (unsigned int y = 0; y < canvas->height; y += band_rows)
 	{
-		for (unsigned int x = 0; x < canvas->width; ++x)
-		{
-			const unsigned int red   = it->red   > 0 ? static_cast<unsigned int>(round(it->red   * 255.0f)) : 0;
-			const unsigned int green = it->green > 0 ? static_cast<unsigned int>(round(it->green * 255.0f)) : 0;
-			const unsigned int blue  = it->blue  > 0 ? static_cast<unsigned int>(round(it->blue  * 255.0f)) : 0;
+		const unsigned int rows = std::min(band_rows, canvas->height - y);
+		this->quantizer_.to_rgb8(canvas->read_rows(y, rows, scratch), static_cast<size_t>(rows) * canvas->width, bytes.data());
+		output.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(rows * row_bytes));
+	}
 
-			output << (red > 255 ? 255 : red);
-			char_counter = char_counter + 3;
-			if (char_counter + 7 > 70)
-			{
-				output << std::endl;
-				char_counter = 0;
-			} else
-			{
-				output << " ";
-				char_counter = char_counter + 1;
-			}
+	RT_STAT_ADD(bytes_written, written_bytes(output));
+	output.close();
+}
 
-			
-			output << (green > 255 ? 255 : green);
-			char_counter = char_counter + 3;
-			if (char_counter + 7 > 70)
-			{
-				output << std::endl;
-				char_counter = 0;
-			}
-			else
-			{
-				output << " ";
-				char_counter = char_counter + 1;
-			}
+void PpmWriter::write_p3(const Canvas* canvas) const
+{
+	std::ofstream output(this->outputFileName_);
 
+	// if(output.is_open())
+	// {
+	ppm::write_header(output, PpmFormat::P3, canvas->width, canvas->height);
 
-			output << (blue > 255 ? 255 : blue);
-			char_counter = char_counter + 3;
-			if (x == last_coll_offset || (char_counter + 7 > 70))
-			{
-				output << std::endl;
-				char_counter = 0;
-			}
-			else
-			{
-				output << " ";
-				char_counter = char_counter + 1;
-			}
+	canvas->advise_sequential();
+	std::vector<rt_math::color> scratch;
+	std::vector<unsigned char> bytes(static_cast<size_t>(canvas->width) * Canvas::tile_size * 3);
+	for(unsigned int y = 0; y < canvas->height; y += Canvas::tile_size)
+	{
+		const unsigned int rows = std::min(Canvas::tile_size, canvas->height - y);
+		this->quantizer_.to_rgb8(canvas->read_rows(y, rows, scratch), static_cast<size_t>(rows) * canvas->width, bytes.data());
 
-			std::advance(it, 1);
+		const unsigned char* row = bytes.data();
+		for (unsigned int band_y = 0; band_y < rows; ++band_y)
+		{
+			ppm::write_p3_row(output, row, canvas->width);
+			row += static_cast<size_t>(canvas->width) * 3;
 		}
 	}
-	
 
+	RT_STAT_ADD(bytes_written, written_bytes(output));
 	output.close();
 	// } 
 }
@@ -4,15 +4,22 @@
 #include <utility>
 
 #include "Canvas.h"
+#include "PpmEncoding.h"
+#include "Quantizer.h"
 
 class PpmWriter
 {
 
 private:
 	std::string outputFileName_;
+	PpmFormat format_;
+	Quantizer quantizer_;
+
+	void write_p3(const Canvas* canvas) const;
+	void write_p6(const Canvas* canvas) const;
 
 public:
-	PpmWriter(std::string outputFileName) : outputFileName_(std::move(outputFileName)) {}
+	PpmWriter(std::string outputFileName, const PpmFormat format = PpmFormat::P3, const ToneMapping& mapping = ToneMapping())
+		: outputFileName_(std::move(outputFileName)), format_(format), quantizer_(mapping) {}
 	void canvas_to_ppm(const Canvas* canvas) const;
 };
-
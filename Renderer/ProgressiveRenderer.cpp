@@ -0,0 +1,56 @@
+#include "pch.h"
+#include "ProgressiveRenderer.h"
+
+#include <algorithm>
+#include <cmath>
+
+ProgressiveRenderer::ProgressiveRenderer(TileRenderer& renderer, Canvas& canvas, const ProgressiveSettings& settings)
+	: renderer_(renderer), canvas_(canvas), settings_(settings),
+	  tiles_x_((canvas.width + renderer.tile_size() - 1) / renderer.tile_size()),
+	  next_block_(settings.coarse_block)
+{
+	const unsigned int tiles_y = (canvas.height + renderer.tile_size() - 1) / renderer.tile_size();
+	this->tile_samples_.assign(static_cast<size_t>(this->tiles_x_) * tiles_y, 0);
+	this->tile_sums_.resize(this->tile_samples_.size());
+	this->settings_.max_samples = std::max(this->settings_.max_samples, 1u);
+}
+
+bool ProgressiveRenderer::finished() const
+{
+	return this->samples_per_pixel() >= this->settings_.max_samples;
+}
+
+size_t ProgressiveRenderer::accumulator_bytes() const
+{
+	size_t bytes = 0;
+	for (const std::vector<rt_math::color>& sums : this->tile_sums_)
+	{
+		bytes += sums.capacity() * sizeof(rt_math::color);
+	}
+	return bytes;
+}
+
+unsigned int ProgressiveRenderer::samples_per_pixel() const
+{
+	if (this->tile_samples_.empty())
+	{
+		return this->settings_.max_samples;
+	}
+	return *std::min_element(this->tile_samples_.begin(), this->tile_samples_.end());
+}
+
+/*
+ * R2 low discrepancy sequence around the center: any prefix of it covers the pixel evenly,
+ * so the image is as good as it can be for the samples taken whenever rendering stops.
+ */
+std::pair<float, float> ProgressiveRenderer::sample_offset(unsigned int const index)
+{
+	// 1 / g and 1 / g^2, g the plastic number
+	constexpr double a1 = 0.7548776662466927;
+	constexpr double a2 = 0.5698402909980532;
+
+	double integral;
+	const double x = std::modf(0.5 + a1 * index, &integral);
+	const double y = std::modf(0.5 + a2 * index, &integral);
+	return { static_cast<float>(x), static_cast<float>(y) };
+}
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+#include <vector>
+
+#include "Canvas.h"
+#include "TileRenderer.h"
+
+/*
+ * How a progressive render refines.
+ * coarse_block: edge of the blocks the first pass fills with a single sample, halved every
+ *   following coarse pass until blocks are 2 pixels wide. 1 skips the coarse passes.
+ * max_samples: samples per pixel after which the image is final.
+ */
+struct ProgressiveSettings
+{
+	unsigned int coarse_block = 8;
+	unsigned int max_samples = 16;
+};
+
+/*
+ * Renders into a canvas in passes, so there is an image almost at once and a better one later:
+ * first coarse passes at a fraction of the resolution, then one more sample per pixel per pass.
+ * Samples are summed in float, the canvas always holds their mean,
+ * so it can be written out with PpmWriter between any two passes.
+ *
+ * The sums are kept per tile, at full precision whatever the canvas's PixelFormat:
+ * a tile gets them with its first refinement sample and frees them once it is final.
+ * Coarse passes need none, but while refining every unfinished pixel costs
+ * sizeof(rt_math::color) on top of the canvas, so a half or RGBA8 canvas does not
+ * save memory until its tiles finish.
+ *
+ * Every pass checks the deadline before each tile and skips the rest of its tiles once it passed.
+ * Finished tiles keep their new samples, skipped ones the previous pass's image,
+ * and the next call picks up where this one stopped.
+ * The very first pass ignores the deadline, so the canvas is never left unrendered.
+ */
+class ProgressiveRenderer
+{
+	public:
+
+		using Clock = std::chrono::steady_clock;
+
+		// renderer and canvas must outlive this
+		ProgressiveRenderer(TileRenderer& renderer, Canvas& canvas, const ProgressiveSettings& settings = ProgressiveSettings());
+
+		/*
+		 * Runs passes until the image is final or the deadline passes.
+		 * Returns true if the image is final.
+		 */
+		template <typename Shader>
+		bool render(const Shader& shader, Clock::time_point deadline)
+		{
+			while (!this->finished() && (this->passes_ == 0 || Clock::now() < deadline))
+			{
+				this->render_pass(shader, deadline);
+			}
+			return this->finished();
+		}
+
+		/*
+		 * One coarse or refinement pass. Shader is called like TileRenderer::render does,
+		 * with image coordinates of the sample, which is no longer always the pixel center.
+		 */
+		template <typename Shader>
+		void render_pass(const Shader& shader, Clock::time_point deadline)
+		{
+			if (this->passes_ == 0)
+			{
+				deadline = Clock::time_point::max();
+			}
+
+			if (this->next_block_ > 1)
+			{
+				const unsigned int block = this->next_block_;
+				this->renderer_.for_each_tile(this->canvas_.width, this->canvas_.height, [this, &shader, block, deadline](const Tile& tile)
+				{
+					if (Clock::now() < deadline)
+					{
+						this->coarse_tile(tile, block, shader);
+					}
+				});
+				this->next_block_ /= 2;
+			}
+			else
+			{
+				this->renderer_.for_each_tile(this->canvas_.width, this->canvas_.height, [this, &shader, deadline](const Tile& tile)
+				{
+					if (Clock::now() < deadline)
+					{
+						this->refine_tile(tile, shader);
+					}
+				});
+			}
+
+			++this->passes_;
+		}
+
+		[[nodiscard]] bool finished() const;
+		// samples every pixel has at least
+		[[nodiscard]] unsigned int samples_per_pixel() const;
+		[[nodiscard]] unsigned int passes() const { return this->passes_; }
+		// bytes held for the sums of unfinished tiles, not to be called during a pass
+		[[nodiscard]] size_t accumulator_bytes() const;
+
+		// offset from the pixel corner of sample number index, the first is the center
+		[[nodiscard]] static std::pair<float, float> sample_offset(unsigned int index);
+
+	private:
+
+		TileRenderer& renderer_;
+		Canvas& canvas_;
+		ProgressiveSettings settings_;
+
+		// per tile of renderer_, sum of all samples of its pixels, row major inside the tile;
+		// empty before the first refinement sample and after the last
+		std::vector<std::vector<rt_math::color>> tile_sums_;
+		// samples taken so far, per tile of renderer_; tiles advance independently when a deadline cuts a pass
+		std::vector<unsigned int> tile_samples_;
+		unsigned int tiles_x_;
+
+		unsigned int next_block_;
+		unsigned int passes_ = 0;
+
+		[[nodiscard]] unsigned int tile_index(const Tile& tile) const
+		{
+			return (tile.y0 / this->renderer_.tile_size()) * this->tiles_x_ + tile.x0 / this->renderer_.tile_size();
+		}
+
+		// one sample at the center of every block x block square, copied to the whole square
+		template <typename Shader>
+		void coarse_tile(const Tile& tile, unsigned int const block, const Shader& shader)
+		{
+			thread_local std::vector<rt_math::color> pixels;
+			const unsigned int tile_width = tile.x1 - tile.x0;
+			pixels.resize(static_cast<size_t>(tile_width) * (tile.y1 - tile.y0));
+
+			for (unsigned int block_y = tile.y0; block_y < tile.y1; block_y += block)
+			{
+				const unsigned int block_y1 = std::min(block_y + block, tile.y1);
+				for (unsigned int block_x = tile.x0; block_x < tile.x1; block_x += block)
+				{
+					const unsigned int block_x1 = std::min(block_x + block, tile.x1);
+					const rt_math::color sample = shader(
+						static_cast<float>(block_x + block_x1) * 0.5f,
+						static_cast<float>(block_y + block_y1) * 0.5f);
+
+					for (unsigned int y = block_y; y < block_y1; ++y)
+					{
+						std::fill_n(pixels.begin() + (static_cast<size_t>(y - tile.y0) * tile_width + (block_x - tile.x0)), block_x1 - block_x, sample);
+					}
+				}
+			}
+
+			this->canvas_.write_block(tile.x0, tile.y0, tile_width, tile.y1 - tile.y0, pixels.data());
+			RT_STAT_ADD(primary_rays, ((tile_width + block - 1) / block) * ((tile.y1 - tile.y0 + block - 1) / block));
+		}
+
+		// one more sample for every pixel of the tile, canvas gets the new mean
+		template <typename Shader>
+		void refine_tile(const Tile& tile, const Shader& shader)
+		{
+			const unsigned int index = this->tile_index(tile);
+			unsigned int& samples = this->tile_samples_[index];
+			if (samples >= this->settings_.max_samples)
+			{
+				return;
+			}
+
+			thread_local std::vector<rt_math::color> pixels;
+			const unsigned int tile_width = tile.x1 - tile.x0;
+			pixels.resize(static_cast<size_t>(tile_width) * (tile.y1 - tile.y0));
+
+			// only the thread rendering this tile touches its sums
+			std::vector<rt_math::color>& sums = this->tile_sums_[index];
+			if (samples == 0)
+			{
+				sums.assign(pixels.size(), rt_math::color(0, 0, 0));
+			}
+
+			const auto [offset_x, offset_y] = sample_offset(samples);
+			const float weight = 1.0f / static_cast<float>(samples + 1);
+			rt_math::color* sum = sums.data();
+			rt_math::color* pixel = pixels.data();
+			for (unsigned int y = tile.y0; y < tile.y1; ++y)
+			{
+				for (unsigned int x = tile.x0; x < tile.x1; ++x, ++sum)
+				{
+					*sum = *sum + shader(static_cast<float>(x) + offset_x, static_cast<float>(y) + offset_y);
+					*pixel++ = *sum * weight;
+				}
+			}
+
+			this->canvas_.write_block(tile.x0, tile.y0, tile_width, tile.y1 - tile.y0, pixels.data());
+			RT_STAT_ADD(primary_rays, pixels.size());
+			if (++samples == this->settings_.max_samples)
+			{
+				// the canvas holds the final mean
+				std::vector<rt_math::color>().swap(sums);
+			}
+		}
+};
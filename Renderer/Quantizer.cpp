@@ -0,0 +1,87 @@
+#include "pch.h"
+#include "Quantizer.h"
+
+#include <cmath>
+
+#include "../Math/Simd.h"
+
+Quantizer::Quantizer(const ToneMapping& mapping) : mapping_(mapping)
+{
+	if (mapping.gamma != 1.0f)
+	{
+		this->gamma_table_.resize(gamma_steps + 1);
+		for (int i = 0; i <= gamma_steps; ++i)
+		{
+			const float corrected = std::pow(static_cast<float>(i) / gamma_steps, 1.0f / mapping.gamma);
+			this->gamma_table_[i] = static_cast<unsigned char>(corrected * 255.0f + 0.5f);
+		}
+	}
+}
+
+/*
+ * A color is 16 bytes, red green blue and padding, so it loads straight into one register.
+ * Four of them are converted and packed into 16 bytes, then the padding bytes are dropped.
+ * Rounding is + 0.5 and truncate, which matches round() for the clamped, non negative values.
+ */
+void Quantizer::to_rgb8(const rt_math::color* pixels, size_t const count, unsigned char* out) const
+{
+	using namespace rt_math::simd;
+
+	const float4 exposure = set1(this->mapping_.exposure);
+	const float4 zero_lanes = zero();
+	const float4 one = set1(1.0f);
+	const float4 half = set1(0.5f);
+	const bool reinhard = this->mapping_.curve == ToneCurve::Reinhard;
+	const bool use_table = !this->gamma_table_.empty();
+	// with a gamma table the lanes become table indices, otherwise bytes
+	const float4 scale = set1(use_table ? static_cast<float>(gamma_steps) : 255.0f);
+
+	const auto convert = [&](const rt_math::color& pixel)
+	{
+		float4 value = mul(pixel.lanes(), exposure);
+		// max first, so NaN lanes become 0
+		value = max(value, zero_lanes);
+		if (reinhard)
+		{
+			value = div(value, add(one, value));
+		}
+		value = min(value, one);
+		return to_int(add(mul(value, scale), half));
+	};
+
+	alignas(16) unsigned char packed[16];
+	alignas(16) int indices[16];
+	for (size_t i = 0; i < count; i += 4)
+	{
+		const size_t group = count - i < 4 ? count - i : 4;
+		const rt_math::color black(0, 0, 0);
+		const int4 a = convert(pixels[i]);
+		const int4 b = convert(group > 1 ? pixels[i + 1] : black);
+		const int4 c = convert(group > 2 ? pixels[i + 2] : black);
+		const int4 d = convert(group > 3 ? pixels[i + 3] : black);
+
+		if (use_table)
+		{
+			store(indices, a);
+			store(indices + 4, b);
+			store(indices + 8, c);
+			store(indices + 12, d);
+			for (size_t lane = 0; lane < 16; ++lane)
+			{
+				packed[lane] = this->gamma_table_[indices[lane]];
+			}
+		}
+		else
+		{
+			store_bytes(packed, a, b, c, d);
+		}
+
+		for (size_t pixel = 0; pixel < group; ++pixel)
+		{
+			out[0] = packed[pixel * 4];
+			out[1] = packed[pixel * 4 + 1];
+			out[2] = packed[pixel * 4 + 2];
+			out += 3;
+		}
+	}
+}
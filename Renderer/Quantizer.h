@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "../Math/Math.h"
+
+enum class ToneCurve
+{
+	// values above 1 clip
+	Linear,
+	// c / (1 + c), compresses any HDR value into 0..1
+	Reinhard
+};
+
+/*
+ * What happens to a linear color on its way to 8 bits:
+ * scaled by exposure, tone curve applied, clamped to 0..1, raised to 1 / gamma.
+ * The defaults leave the color as is, 0.5 becomes 128.
+ */
+struct ToneMapping
+{
+	ToneCurve curve = ToneCurve::Linear;
+	float exposure = 1.0f;
+	float gamma = 1.0f;
+};
+
+/*
+ * Converts colors to 8 bit RGB in bulk, four pixels per SIMD step.
+ * Shared by every writer, so all output formats quantize identically.
+ *
+ * Gamma other than 1 goes through a lookup table built once per quantizer,
+ * indexed by the clamped value at 1/4095 steps.
+ */
+class Quantizer
+{
+	public:
+
+		explicit Quantizer(const ToneMapping& mapping = ToneMapping());
+
+		[[nodiscard]] const ToneMapping& mapping() const { return this->mapping_; }
+
+		// 3 bytes per pixel into out
+		void to_rgb8(const rt_math::color* pixels, size_t count, unsigned char* out) const;
+
+	private:
+
+		static constexpr int gamma_steps = 4095;
+
+		ToneMapping mapping_;
+		// empty when gamma is 1
+		std::vector<unsigned char> gamma_table_;
+};
@@ -0,0 +1,270 @@
+#include "pch.h"
+#include "TileRenderer.h"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+
+TileRenderer::TileRenderer(unsigned int thread_count, unsigned int const tile_size)
+	: tile_size_(tile_size == 0 ? 1 : tile_size)
+{
+	// hardware_concurrency() may report 0 when it cannot tell
+	thread_count = std::max(thread_count, 1u);
+
+	this->runs_ = std::make_unique<TileRun[]>(thread_count);
+	this->workers_.reserve(thread_count - 1);
+	for (unsigned int i = 1; i < thread_count; ++i)
+	{
+		this->workers_.emplace_back(&TileRenderer::worker_loop, this, i);
+	}
+}
+
+TileRenderer::~TileRenderer()
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex_);
+		this->stopping_ = true;
+	}
+	this->frame_started_.notify_all();
+
+	for (std::thread& worker : this->workers_)
+	{
+		worker.join();
+	}
+}
+
+void TileRenderer::for_each_tile(unsigned int const width, unsigned int const height, const TileJob& job)
+{
+	this->tiles_x_ = (width + this->tile_size_ - 1) / this->tile_size_;
+	const unsigned int tiles_y = (height + this->tile_size_ - 1) / this->tile_size_;
+	const unsigned int tile_count = this->tiles_x_ * tiles_y;
+	if (tile_count == 0)
+	{
+		return;
+	}
+
+	this->job_ = &job;
+	this->width_ = width;
+	this->height_ = height;
+
+	// neighbouring tiles go to the same thread first, stealing evens out the rest
+	const unsigned int run_count = this->thread_count();
+	for (unsigned int i = 0; i < run_count; ++i)
+	{
+		this->runs_[i].next.store(static_cast<unsigned int>(static_cast<unsigned long long>(tile_count) * i / run_count), std::memory_order_relaxed);
+		this->runs_[i].end = static_cast<unsigned int>(static_cast<unsigned long long>(tile_count) * (i + 1) / run_count);
+	}
+
+	// publishing the frame under the mutex also publishes the runs above to the workers
+	{
+		std::lock_guard<std::mutex> lock(this->mutex_);
+		++this->frame_;
+		this->busy_workers_ = static_cast<unsigned int>(this->workers_.size());
+	}
+	this->frame_started_.notify_all();
+
+	RT_TRACE_SCOPE("frame");
+	this->work(0);
+
+	std::exception_ptr error;
+	{
+		std::unique_lock<std::mutex> lock(this->mutex_);
+		this->frame_finished_.wait(lock, [this] { return this->busy_workers_ == 0; });
+		std::swap(error, this->error_);
+	}
+	this->job_ = nullptr;
+	this->failed_.store(false, std::memory_order_relaxed);
+
+	if (error)
+	{
+		std::rethrow_exception(error);
+	}
+}
+
+void TileRenderer::worker_loop(unsigned int const worker_index)
+{
+	RT_TRACE_THREAD_NAME("tile worker " + std::to_string(worker_index));
+
+	unsigned long long seen_frame = 0;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(this->mutex_);
+			this->frame_started_.wait(lock, [this, seen_frame] { return this->stopping_ || this->frame_ != seen_frame; });
+			if (this->stopping_)
+			{
+				return;
+			}
+			seen_frame = this->frame_;
+		}
+
+		this->work(worker_index);
+
+		bool last;
+		{
+			std::lock_guard<std::mutex> lock(this->mutex_);
+			last = --this->busy_workers_ == 0;
+		}
+		if (last)
+		{
+			this->frame_finished_.notify_one();
+		}
+	}
+}
+
+void TileRenderer::work(unsigned int const worker_index)
+{
+	rt_math::Arena& arena = rt_math::thread_arena();
+	const rt_math::Arena::Mark before_tiles = arena.mark();
+
+	// own run first, then steal from the others in turn
+	const unsigned int run_count = this->thread_count();
+	for (unsigned int k = 0; k < run_count && !this->failed_.load(std::memory_order_relaxed); ++k)
+	{
+		TileRun& run = this->runs_[(worker_index + k) % run_count];
+		while (!this->failed_.load(std::memory_order_relaxed))
+		{
+			const unsigned int tile_index = run.next.fetch_add(1, std::memory_order_relaxed);
+			if (tile_index >= run.end)
+			{
+				break;
+			}
+
+			try
+			{
+				RT_TRACE_SCOPE("tile");
+				(*this->job_)(this->tile_at(tile_index));
+			}
+			catch (...)
+			{
+				// the job belongs to the caller, whose frame waits for every thread before rethrowing
+				std::lock_guard<std::mutex> lock(this->mutex_);
+				if (!this->error_)
+				{
+					this->error_ = std::current_exception();
+				}
+				this->failed_.store(true, std::memory_order_relaxed);
+			}
+			// lists the shader allocated for this tile's pixels are done with,
+			// what the thread held before the frame stays, it may be the caller's
+			arena.rewind(before_tiles);
+			RT_STAT_ADD(tiles, 1);
+		}
+	}
+
+#ifndef RT_DISABLE_STATS
+	// once per thread and frame, so the hot loop only ever touches its own counters
+	rt_math::stats::flush();
+#endif
+}
+
+Tile TileRenderer::tile_at(unsigned int const tile_index) const
+{
+	const unsigned int x0 = (tile_index % this->tiles_x_) * this->tile_size_;
+	const unsigned int y0 = (tile_index / this->tiles_x_) * this->tile_size_;
+
+	return Tile{
+		x0, y0,
+		std::min(x0 + this->tile_size_, this->width_),
+		std::min(y0 + this->tile_size_, this->height_)
+	};
+}
+
+TileRenderer::BandSinkThread::BandSinkThread(std::function<void(const Canvas&, unsigned int)> sink)
+	: sink_(std::move(sink))
+{
+	this->thread_ = std::thread(&BandSinkThread::run, this);
+}
+
+TileRenderer::BandSinkThread::~BandSinkThread()
+{
+	this->stop();
+}
+
+bool TileRenderer::BandSinkThread::post(const Canvas& band, unsigned int const rows)
+{
+	{
+		std::unique_lock<std::mutex> lock(this->mutex_);
+		this->changed_.wait(lock, [this] { return this->band_ == nullptr; });
+		if (this->error_)
+		{
+			return false;
+		}
+
+		this->band_ = &band;
+		this->rows_ = rows;
+	}
+	this->changed_.notify_all();
+
+	return true;
+}
+
+void TileRenderer::BandSinkThread::finish()
+{
+	this->stop();
+
+	if (this->error_)
+	{
+		std::rethrow_exception(this->error_);
+	}
+}
+
+void TileRenderer::BandSinkThread::stop()
+{
+	if (!this->thread_.joinable())
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(this->mutex_);
+		this->finished_ = true;
+	}
+	this->changed_.notify_all();
+	this->thread_.join();
+}
+
+void TileRenderer::BandSinkThread::run()
+{
+	RT_TRACE_THREAD_NAME("band sink");
+
+	std::unique_lock<std::mutex> lock(this->mutex_);
+	for (;;)
+	{
+		// a posted band is sunk before finishing
+		this->changed_.wait(lock, [this] { return this->band_ != nullptr || this->finished_; });
+		if (this->band_ == nullptr)
+		{
+			break;
+		}
+
+		const Canvas* band = this->band_;
+		const unsigned int rows = this->rows_;
+		lock.unlock();
+
+		std::exception_ptr error;
+		try
+		{
+			RT_TRACE_SCOPE("band sink");
+			this->sink_(*band, rows);
+		}
+		catch (...)
+		{
+			error = std::current_exception();
+		}
+
+		lock.lock();
+		if (error)
+		{
+			this->error_ = error;
+		}
+		this->band_ = nullptr;
+		this->changed_.notify_all();
+	}
+	lock.unlock();
+
+#ifndef RT_DISABLE_STATS
+	// the sink thread is gone by the time the frame is collected
+	rt_math::stats::flush();
+#endif
+}
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <atomic>
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Canvas.h"
+#include "../Math/Arena.h"
+#include "../Math/Stats.h"
+#include "../Math/Trace.h"
+
+/*
+ * Rectangle of pixels [x0, x1) x [y0, y1)
+ */
+struct Tile
+{
+	unsigned int x0, y0, x1, y1;
+};
+
+/*
+ * Splits the canvas into square tiles and renders them on a pool of worker threads.
+ *
+ * Each worker starts on its own contiguous run of tiles and, once that is used up,
+ * steals remaining tiles from the other workers' runs. Claiming a tile is one atomic
+ * increment, so no lock is taken per tile. Tiles never overlap, so workers write
+ * their pixels straight into the canvas without locking it either.
+ *
+ * Workers live as long as the renderer, so repeated frames do not pay for thread startup.
+ * Every thread that took part in a frame flushes its rt_math::stats counters before the frame returns.
+ * Shaders can take short-lived lists from rt_math::thread_arena(), see render().
+ */
+class TileRenderer
+{
+	public:
+
+		using TileJob = std::function<void(const Tile&)>;
+
+		explicit TileRenderer(unsigned int thread_count = std::thread::hardware_concurrency(), unsigned int tile_size = 32);
+		~TileRenderer();
+
+		TileRenderer(const TileRenderer&) = delete;
+		TileRenderer& operator=(const TileRenderer&) = delete;
+
+		[[nodiscard]] unsigned int thread_count() const { return static_cast<unsigned int>(this->workers_.size()) + 1; }
+		[[nodiscard]] unsigned int tile_size() const { return this->tile_size_; }
+
+		/*
+		 * Shader is called as shader(x, y) with the canvas coordinates of the pixel center
+		 * and returns the rt_math::color to store. It must be safe to call from several threads.
+		 *
+		 * Shaders may allocate scratch data from rt_math::thread_arena(). After every tile the arena
+		 * is rewound to where it was before the frame, so nothing allocated there outlives its tile.
+		 * What the calling thread allocated from its arena before calling render stays valid.
+		 */
+		template <typename Shader>
+		void render(Canvas& canvas, const Shader& shader)
+		{
+			this->for_each_tile(canvas.width, canvas.height, [&canvas, &shader](const Tile& tile)
+			{
+				shade_tile(canvas, tile, 0, shader);
+			});
+		}
+
+		/*
+		 * Renders a width x height image band_height rows at a time (at least 1), into two band sized canvases.
+		 * Every finished band goes to sink(band, rows) on one sink thread kept for the whole call, top to bottom,
+		 * while the next band renders. Only two bands are ever in memory, not the whole frame.
+		 * If the sink throws, no further bands are rendered and the exception is rethrown here.
+		 * Shaders may use rt_math::thread_arena() as in render().
+		 */
+		template <typename Shader, typename Sink>
+		void render_bands(unsigned int const width, unsigned int const height, unsigned int const band_height, const Shader& shader, Sink&& sink)
+		{
+			const unsigned int rows_per_band = std::max(band_height, 1u);
+			Canvas bands[2] = { Canvas(width, rows_per_band), Canvas(width, rows_per_band) };
+			BandSinkThread sink_thread([&sink](const Canvas& band, const unsigned int rows)
+			{
+				sink(band, rows);
+			});
+
+			unsigned int band_index = 0;
+			for (unsigned int band_y = 0; band_y < height; band_y += rows_per_band, ++band_index)
+			{
+				// the other buffer may still be in the sink, this one was released a band ago
+				Canvas& band = bands[band_index % 2];
+				const unsigned int rows = std::min(rows_per_band, height - band_y);
+
+				this->for_each_tile(width, rows, [&band, &shader, band_y](const Tile& tile)
+				{
+					shade_tile(band, tile, band_y, shader);
+				});
+
+				if (!sink_thread.post(band, rows))
+				{
+					break;
+				}
+			}
+
+			sink_thread.finish();
+		}
+
+		/*
+		 * Runs job once for every tile of a width x height area, blocks until all are done.
+		 * The calling thread works on tiles as well.
+		 * If job throws, on any thread, no further tiles are started and the first exception
+		 * is rethrown here once every thread has left the frame.
+		 */
+		void for_each_tile(unsigned int width, unsigned int height, const TileJob& job);
+
+	private:
+
+		/*
+		 * The thread render_bands hands finished bands to. post() waits until the previous band
+		 * is through the sink, so the sink sees one band at a time and the other buffer is free.
+		 */
+		class BandSinkThread
+		{
+			public:
+				explicit BandSinkThread(std::function<void(const Canvas&, unsigned int)> sink);
+				// joins without rethrowing, for when rendering itself threw
+				~BandSinkThread();
+
+				BandSinkThread(const BandSinkThread&) = delete;
+				BandSinkThread& operator=(const BandSinkThread&) = delete;
+
+				// false once the sink has thrown, the band is then dropped
+				bool post(const Canvas& band, unsigned int rows);
+				// waits for the last band, joins the thread and rethrows what the sink threw
+				void finish();
+
+			private:
+				std::function<void(const Canvas&, unsigned int)> sink_;
+				std::mutex mutex_;
+				std::condition_variable changed_;
+				// posted and not yet through the sink
+				const Canvas* band_ = nullptr;
+				unsigned int rows_ = 0;
+				bool finished_ = false;
+				std::exception_ptr error_;
+				std::thread thread_;
+
+				void run();
+				void stop();
+		};
+
+		// one run of tile indices per worker; next is claimed by owner and thieves alike
+		struct alignas(64) TileRun
+		{
+			std::atomic<unsigned int> next{ 0 };
+			unsigned int end = 0;
+		};
+
+		unsigned int tile_size_;
+		std::vector<std::thread> workers_;
+		std::unique_ptr<TileRun[]> runs_;
+
+		// current frame
+		const TileJob* job_ = nullptr;
+		unsigned int width_ = 0, height_ = 0, tiles_x_ = 0;
+
+		std::mutex mutex_;
+		std::condition_variable frame_started_;
+		std::condition_variable frame_finished_;
+		unsigned long long frame_ = 0;
+		unsigned int busy_workers_ = 0;
+		bool stopping_ = false;
+		// first exception a job threw this frame, under mutex_; failed_ tells the others to stop claiming tiles
+		std::exception_ptr error_;
+		std::atomic<bool> failed_{ false };
+
+		/*
+		 * tile is in canvas coordinates, y_offset moves it to image coordinates for the shader.
+		 * The tile is shaded into a float buffer owned by the thread, then stored in one go,
+		 * so compact canvases are only converted once per pixel and the floats never outlive the tile.
+		 */
+		template <typename Shader>
+		static void shade_tile(Canvas& canvas, const Tile& tile, unsigned int const y_offset, const Shader& shader)
+		{
+			thread_local std::vector<rt_math::color> accumulation;
+			const unsigned int tile_width = tile.x1 - tile.x0;
+			accumulation.resize(static_cast<size_t>(tile_width) * (tile.y1 - tile.y0));
+
+			rt_math::color* pixel = accumulation.data();
+			for (unsigned int y = tile.y0; y < tile.y1; ++y)
+			{
+				const float image_y = static_cast<float>(y + y_offset) + 0.5f;
+				for (unsigned int x = tile.x0; x < tile.x1; ++x)
+				{
+					*pixel++ = shader(static_cast<float>(x) + 0.5f, image_y);
+				}
+			}
+
+			canvas.write_block(tile.x0, tile.y0, tile_width, tile.y1 - tile.y0, accumulation.data());
+			RT_STAT_ADD(primary_rays, accumulation.size());
+		}
+
+		void worker_loop(unsigned int worker_index);
+		void work(unsigned int worker_index);
+		[[nodiscard]] Tile tile_at(unsigned int tile_index) const;
+};
@@ -1,20 +1,68 @@
-// raytracing.cpp : This file contains the 'main' function. Program execution begins and ends there.
+// raytracing.cpp : Chapter 5 sphere silhouette, rendered in tiles on all cores.
 //
 
+#include <fstream>
 #include <iostream>
+#include <numbers>
+#include "../Math/Math.h"
+#include "../Math/Geometry.h"
+#include "../Math/Stats.h"
+#include "../Math/Trace.h"
+
+#include "../Renderer/Canvas.h"
+#include "../Renderer/PpmStreamWriter.h"
+#include "../Renderer/TileRenderer.h"
 
 int main()
 {
-    std::cout << "Hello World!\n";
-}
+    RT_TRACE_THREAD_NAME("main");
+
+    constexpr unsigned int canvas_pixels = 500;
+
+    // wall behind the sphere, camera in front of it
+    const rt_math::tuple ray_origin = rt_math::point(0, 0, -5);
+    constexpr float wall_z = 10.0f;
+    constexpr float wall_size = 7.0f;
+    constexpr float pixel_size = wall_size / canvas_pixels;
+    constexpr float half = wall_size / 2;
+
+    Sphere sphere = Sphere();
+    {
+        RT_TRACE_SCOPE("transform precomputation");
+        sphere.set_transform(
+            rotation_z(std::numbers::pi_v<float> / 4) * scaling(0.5f, 1, 1)
+        );
+    }
+
+    constexpr rt_math::color red = rt_math::color(1, 0, 0);
+    TileRenderer renderer;
+    std::cout << "Rendering on " << renderer.thread_count() << " threads" << std::endl;
 
-// Run program: Ctrl + F5 or Debug > Start Without Debugging menu
-// Debug program: F5 or Debug > Start Debugging menu
+    // bands go to disk while the next ones render, the full canvas is never held in memory
+    PpmStreamWriter writer("sphere.ppm", canvas_pixels, canvas_pixels, PpmFormat::P3);
+    const auto shader = [&](const float x, const float y)
+    {
+        // canvas y grows down, world y grows up
+        const float world_x = -half + pixel_size * x;
+        const float world_y = half - pixel_size * y;
+        const rt_math::tuple position = rt_math::point(world_x, world_y, wall_z);
 
-// Tips for Getting Started: 
-//   1. Use the Solution Explorer window to add/manage files
-//   2. Use the Team Explorer window to connect to source control
-//   3. Use the Output window to see build output and other messages
-//   4. Use the Error List window to view errors
-//   5. Go to Project > Add New Item to create new code files, or Project > Add Existing Item to add existing code files to the project
-//   6. In the future, to open this project again, go to File > Open > Project and select the .sln file
+        Intersections xs;
+        sphere.intersects(Ray(ray_origin, normalize(position - ray_origin)), xs);
+
+        return xs.empty() ? rt_math::color(0, 0, 0) : red;
+    };
+
+    renderer.render_bands(canvas_pixels, canvas_pixels, renderer.tile_size(), shader, [&writer](const Canvas& band, const unsigned int rows)
+    {
+        writer.write_rows(band, rows);
+    });
+
+    rt_math::stats::report(std::cout, rt_math::stats::collect());
+
+#ifdef RT_TRACE
+    std::ofstream trace("sphere.trace.json");
+    rt_math::trace::write_json(trace);
+    std::cout << "Timeline written to sphere.trace.json" << std::endl;
+#endif
+}